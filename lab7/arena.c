@@ -0,0 +1,118 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: arena.c
+ *
+ *       Implementation of the bump pointer arena.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "memcheck.h"
+
+/* Size of the first chunk; later chunks double up to MAX_CHUNK_SIZE. */
+#define MIN_CHUNK_SIZE 4096
+#define MAX_CHUNK_SIZE (1024 * 1024)
+
+/* A type with the strictest alignment any arena object may need. */
+typedef union
+{
+    long l;
+    double d;
+    void *p;
+} max_align;
+
+#define ALIGNMENT sizeof(max_align)
+
+/* Offset of the first object in a chunk, rounded up to ALIGNMENT. */
+#define HEADER_SIZE \
+    ((sizeof(arena_chunk) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+
+
+void new_chunk(arena *a, size_t n);
+
+
+/*
+ * Allocate a chunk with room for at least 'n' bytes and make it the
+ * current one.  Whatever was left in the previous chunk is abandoned.
+ */
+void new_chunk(arena *a, size_t n)
+{
+    arena_chunk *c;
+    size_t size;
+
+    size = a->chunk_size;
+    if (size < n) {
+        size = n;
+    }
+
+    c = (arena_chunk *) malloc(HEADER_SIZE + size);
+    if (c == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    c->next = a->chunks;
+    a->chunks = c;
+    a->next = (char *) c + HEADER_SIZE;
+    a->end = a->next + size;
+
+    if (a->chunk_size < MAX_CHUNK_SIZE) {
+        a->chunk_size *= 2;
+    }
+}
+
+
+void arena_init(arena *a)
+{
+    a->chunks = NULL;
+    a->next = NULL;
+    a->end = NULL;
+    a->chunk_size = MIN_CHUNK_SIZE;
+}
+
+
+void *arena_alloc(arena *a, size_t n)
+{
+    size_t pad;
+    void *result;
+
+    pad = (ALIGNMENT - (unsigned long) a->next % ALIGNMENT) % ALIGNMENT;
+    if (a->next == NULL || (size_t) (a->end - a->next) < pad + n) {
+        new_chunk(a, n);
+        pad = 0;
+    }
+    result = a->next + pad;
+    a->next += pad + n;
+    return result;
+}
+
+
+char *arena_strdup(arena *a, const char *s, size_t len)
+{
+    char *result;
+
+    if (a->next == NULL || (size_t) (a->end - a->next) < len + 1) {
+        new_chunk(a, len + 1);
+    }
+    result = a->next;
+    a->next += len + 1;
+    memcpy(result, s, len);
+    result[len] = '\0';
+    return result;
+}
+
+
+void arena_free(arena *a)
+{
+    arena_chunk *c, *next;
+
+    for (c = a->chunks; c != NULL; c = next) {
+        next = c->next;
+        free(c);
+    }
+    arena_init(a);
+}
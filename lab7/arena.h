@@ -0,0 +1,49 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: arena.h
+ *
+ *       Declaration of a bump pointer arena.  Many small objects are
+ *       carved out of a few large chunks and are all released at once
+ *       by freeing the chunks, instead of one malloc and one free each.
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* One block of arena memory; the objects follow the header. */
+typedef struct _arena_chunk
+{
+    struct _arena_chunk *next;  /* previously allocated chunk */
+} arena_chunk;
+
+typedef struct
+{
+    arena_chunk *chunks;    /* most recently allocated chunk first */
+    char *next;             /* first free byte of the newest chunk */
+    char *end;              /* one past the last byte of that chunk */
+    size_t chunk_size;      /* size of the next chunk to allocate */
+} arena;
+
+/* Initialize an empty arena.  No memory is allocated until needed. */
+void arena_init(arena *a);
+
+/*
+ * Return 'n' bytes of memory, suitably aligned for any object.  The
+ * memory lives until arena_free() is called.
+ */
+void *arena_alloc(arena *a, size_t n);
+
+/*
+ * Copy the 'len' bytes at 's' into the arena, add a zero byte and
+ * return the copy.  Strings are packed without alignment padding.
+ */
+char *arena_strdup(arena *a, const char *s, size_t len);
+
+/* Release all the memory of an arena, one free per chunk. */
+void arena_free(arena *a);
+
+#endif  /* ARENA_H */
@@ -0,0 +1,127 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bloom_filter.c
+ *
+ *       Implementation of the blocked Bloom filter.
+ *
+ *       The low bits of a key's hash pick its block.  The bits within
+ *       the block come from a second mix of the hash, by double hashing:
+ *       bit i is a + i * b modulo 512, with b odd so that the bits are
+ *       all different.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bloom_filter.h"
+#include "hash_func.h"
+#include "memcheck.h"
+
+/* Bytes in a cache line, and bits in a block. */
+#define CACHE_LINE 64
+#define BLOCK_BITS (BLOOM_BLOCK_WORDS * 32)
+
+
+void alloc_blocks(bloom_filter *f, unsigned long capacity);
+
+
+/*
+ * Allocate zeroed blocks for 'capacity' keys, a power of two of them,
+ * aligned to a cache line by hand since memcheck has no aligned malloc.
+ */
+void alloc_blocks(bloom_filter *f, unsigned long capacity)
+{
+    unsigned long nblocks;
+    size_t misalign;
+
+    nblocks = 1;
+    while (nblocks * BLOCK_BITS < capacity * BLOOM_BITS_PER_KEY) {
+        nblocks *= 2;
+    }
+
+    f->mem = malloc(nblocks * sizeof(bloom_block) + CACHE_LINE - 1);
+    if (f->mem == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    misalign = (size_t) f->mem % CACHE_LINE;
+    f->blocks = (bloom_block *) ((char *) f->mem +
+                                 (misalign ? CACHE_LINE - misalign : 0));
+    memset(f->blocks, 0, nblocks * sizeof(bloom_block));
+    f->mask = nblocks - 1;
+    f->capacity = nblocks * BLOCK_BITS / BLOOM_BITS_PER_KEY;
+}
+
+
+bloom_filter *create_bloom_filter(unsigned long capacity)
+{
+    bloom_filter *f;
+
+    f = (bloom_filter *) malloc(sizeof(bloom_filter));
+    if (f == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    alloc_blocks(f, capacity);
+    f->checks = 0;
+    f->rejects = 0;
+    f->false_positives = 0;
+    return f;
+}
+
+
+void clear_bloom_filter(bloom_filter *f, unsigned long capacity)
+{
+    free(f->mem);
+    alloc_blocks(f, capacity);
+}
+
+
+void free_bloom_filter(bloom_filter *f)
+{
+    free(f->mem);
+    free(f);
+}
+
+
+void bloom_add(bloom_filter *f, unsigned long h)
+{
+    bloom_block *block;
+    unsigned long g, a, b;
+    int i;
+
+    block = &f->blocks[h & f->mask];
+    g = hash_ulong(h);
+    a = g % BLOCK_BITS;
+    b = (g / BLOCK_BITS) | 1;
+    for (i = 0; i < BLOOM_PROBES; i++) {
+        block->bits[a / 32] |= 1U << (a % 32);
+        a = (a + b) % BLOCK_BITS;
+    }
+}
+
+
+int bloom_check(bloom_filter *f, unsigned long h)
+{
+    bloom_block *block;
+    unsigned long g, a, b;
+    int i;
+
+    f->checks++;
+    block = &f->blocks[h & f->mask];
+    g = hash_ulong(h);
+    a = g % BLOCK_BITS;
+    b = (g / BLOCK_BITS) | 1;
+    for (i = 0; i < BLOOM_PROBES; i++) {
+        if (!(block->bits[a / 32] & (1U << (a % 32)))) {
+            f->rejects++;
+            return 0;
+        }
+        a = (a + b) % BLOCK_BITS;
+    }
+    return 1;
+}
@@ -0,0 +1,66 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bloom_filter.h
+ *
+ *       Declaration of a blocked Bloom filter over key hashes, which a
+ *       hash table keeps in front of its lookups (see
+ *       hash_table_use_filter() in hash_table.h) so that most lookups of
+ *       absent keys are answered without probing the table.
+ *
+ *       The filter is an array of 64 byte blocks, each one cache line.
+ *       A key sets BLOOM_PROBES bits, all in the one block its hash
+ *       picks, so a check reads a single cache line where a plain Bloom
+ *       filter would read one per bit.
+ *
+ */
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+/* Bits of filter per key it is sized for, and bits set per key. */
+#define BLOOM_BITS_PER_KEY 12
+#define BLOOM_PROBES 8
+
+/* One block: 512 bits in 16 words of 32 bits. */
+#define BLOOM_BLOCK_WORDS 16
+
+typedef struct
+{
+    unsigned int bits[BLOOM_BLOCK_WORDS];
+} bloom_block;
+
+typedef struct
+{
+    void *mem;                  /* what malloc returned */
+    bloom_block *blocks;        /* 'mem' aligned to a cache line */
+    unsigned long mask;         /* number of blocks - 1 */
+    unsigned long capacity;     /* keys the filter is sized for */
+    unsigned long checks;       /* calls to bloom_check() */
+    unsigned long rejects;      /* checks that ruled the key out */
+    unsigned long false_positives;  /* counted by the filter's user */
+} bloom_filter;
+
+/* Create an empty filter sized for 'capacity' keys. */
+bloom_filter *create_bloom_filter(unsigned long capacity);
+
+/*
+ * Empty the filter and size it for 'capacity' keys, keeping its
+ * counters.  A table does this when it outgrows its filter, and then
+ * adds its keys again, which also forgets removed keys.
+ */
+void clear_bloom_filter(bloom_filter *f, unsigned long capacity);
+
+void free_bloom_filter(bloom_filter *f);
+
+/* Add a key, given by its hash_string() value. */
+void bloom_add(bloom_filter *f, unsigned long h);
+
+/*
+ * Return 0 if the key with hash 'h' was certainly never added, or 1 if
+ * it may have been.  A caller that then fails to find the key should
+ * count a false positive.
+ */
+int bloom_check(bloom_filter *f, unsigned long h);
+
+#endif  /* BLOOM_FILTER_H */
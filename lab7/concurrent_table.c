@@ -0,0 +1,319 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: concurrent_table.c
+ *
+ *       Implementation of the concurrent word count table.  The lock
+ *       based schemes reuse whichever hash table engine the program is
+ *       linked with; the lock free scheme has its own slot array and
+ *       uses the GCC __atomic builtins.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "concurrent_table.h"
+#include "hash_table.h"
+#include "hash_func.h"
+#include "memcheck.h"
+
+/* Assumed cache line size, used to keep stripes apart. */
+#define CACHE_LINE 64
+
+/* A lock free table is filled to at most 3/4 of its slots. */
+#define MAX_LOAD_NUM 3
+#define MAX_LOAD_DEN 4
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * A key of a lock free table.  The key's bytes and a zero byte follow
+ * the header in the same allocation.  A key never changes once it has
+ * been published in a slot.
+ */
+
+typedef struct
+{
+    unsigned long hash;
+    unsigned int len;
+} cht_key;
+
+#define KEY_TEXT(k) ((char *) ((k) + 1))
+
+/*
+ * A slot of a lock free table.  'key' goes from NULL to its final
+ * value exactly once, by compare and swap; 'value' is only changed by
+ * atomic adds.
+ */
+
+typedef struct
+{
+    cht_key *key;
+    int value;
+} cht_slot;
+
+/* A hash_table with its own lock, padded to avoid false sharing. */
+typedef struct
+{
+    pthread_mutex_t lock;
+    hash_table *ht;
+    char pad[CACHE_LINE];
+} stripe;
+
+struct _concurrent_table
+{
+    int mode;
+
+    /* CHT_GLOBAL_LOCK (one stripe) and CHT_STRIPED. */
+    int nstripes;
+    stripe *stripes;
+
+    /* CHT_LOCK_FREE. */
+    cht_slot *slots;
+    unsigned long mask;     /* number of slots - 1 */
+    unsigned long limit;    /* most keys the slots may hold */
+    unsigned long nkeys;    /* keys stored so far; atomic */
+};
+
+
+cht_key *make_key(char *key, size_t len, unsigned long h);
+int lock_free_add(concurrent_table *ct, char *key, int delta);
+int lock_free_get(concurrent_table *ct, char *key);
+
+
+/*** Lock free utilities. ***/
+
+/* Make a key record for the 'len' bytes at 'key', whose hash is 'h'. */
+cht_key *make_key(char *key, size_t len, unsigned long h)
+{
+    cht_key *k;
+
+    k = (cht_key *) malloc(sizeof(cht_key) + len + 1);
+    if (k == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    k->hash = h;
+    k->len = (unsigned int) len;
+    memcpy(KEY_TEXT(k), key, len);
+    KEY_TEXT(k)[len] = '\0';
+    return k;
+}
+
+
+/*
+ * Probe for the key.  An empty slot is claimed by swapping in a new
+ * key record; if another thread claims it first, the swap fails and
+ * returns that thread's key, which is then compared like any other.
+ * The record is built only once per call, and freed again if the key
+ * turns out to be present.
+ */
+int lock_free_add(concurrent_table *ct, char *key, int delta)
+{
+    unsigned long h, i;
+    size_t len;
+    cht_key *k, *mine;
+    cht_slot *s;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    mine = NULL;
+
+    for (i = h & ct->mask; ; i = (i + 1) & ct->mask) {
+        s = &ct->slots[i];
+        k = __atomic_load_n(&s->key, __ATOMIC_ACQUIRE);
+
+        if (k == NULL) {
+            if (mine == NULL) {
+                mine = make_key(key, len, h);
+            }
+            if (__atomic_compare_exchange_n(&s->key, &k, mine, 0,
+                                            __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                if (__atomic_add_fetch(&ct->nkeys, 1, __ATOMIC_RELAXED) >
+                    ct->limit) {
+                    fprintf(stderr, "Fatal error: concurrent table is "
+                            "full.  Terminating program.\n");
+                    exit(1);
+                }
+                return __atomic_add_fetch(&s->value, delta,
+                                          __ATOMIC_RELAXED);
+            }
+            /* Lost the race: 'k' is now the key that won. */
+        }
+
+        if (k->hash == h && k->len == len &&
+            !memcmp(KEY_TEXT(k), key, len)) {
+            if (mine != NULL) {
+                free(mine);
+            }
+            return __atomic_add_fetch(&s->value, delta, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+int lock_free_get(concurrent_table *ct, char *key)
+{
+    unsigned long h, i;
+    size_t len;
+    cht_key *k;
+    cht_slot *s;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+
+    for (i = h & ct->mask; ; i = (i + 1) & ct->mask) {
+        s = &ct->slots[i];
+        k = __atomic_load_n(&s->key, __ATOMIC_ACQUIRE);
+        if (k == NULL) {
+            return 0;
+        }
+        if (k->hash == h && k->len == len &&
+            !memcmp(KEY_TEXT(k), key, len)) {
+            return __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+/*** Concurrent table utilities. ***/
+
+concurrent_table *cht_create(int mode, unsigned long capacity_hint)
+{
+    concurrent_table *ct;
+    unsigned long capacity;
+    int i;
+
+    ct = (concurrent_table *) calloc(1, sizeof(concurrent_table));
+    if (ct == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    ct->mode = mode;
+
+    if (mode == CHT_LOCK_FREE) {
+        capacity = 8;
+        while (capacity * MAX_LOAD_NUM / MAX_LOAD_DEN < capacity_hint) {
+            capacity *= 2;
+        }
+        ct->slots = (cht_slot *) calloc(capacity, sizeof(cht_slot));
+        if (ct->slots == NULL) {
+            fprintf(stderr, "Error: memory allocation failed! "
+                    "Terminating program.\n");
+            exit(1);
+        }
+        ct->mask = capacity - 1;
+        ct->limit = capacity * MAX_LOAD_NUM / MAX_LOAD_DEN;
+        ct->nkeys = 0;
+        return ct;
+    }
+
+    ct->nstripes = (mode == CHT_STRIPED) ? CHT_STRIPES : 1;
+    ct->stripes = (stripe *) calloc(ct->nstripes, sizeof(stripe));
+    if (ct->stripes == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    for (i = 0; i < ct->nstripes; i++) {
+        pthread_mutex_init(&ct->stripes[i].lock, NULL);
+        ct->stripes[i].ht =
+            create_hash_table_sized(capacity_hint / ct->nstripes);
+    }
+    return ct;
+}
+
+
+void cht_free(concurrent_table *ct)
+{
+    unsigned long j;
+    int i;
+
+    if (ct->mode == CHT_LOCK_FREE) {
+        for (j = 0; j <= ct->mask; j++) {
+            if (ct->slots[j].key != NULL) {
+                free(ct->slots[j].key);
+            }
+        }
+        free(ct->slots);
+    }
+    else {
+        for (i = 0; i < ct->nstripes; i++) {
+            pthread_mutex_destroy(&ct->stripes[i].lock);
+            free_hash_table(ct->stripes[i].ht);
+        }
+        free(ct->stripes);
+    }
+    free(ct);
+}
+
+
+int cht_get(concurrent_table *ct, char *key)
+{
+    stripe *st;
+    size_t len;
+    int value;
+
+    if (ct->mode == CHT_LOCK_FREE) {
+        return lock_free_get(ct, key);
+    }
+
+    len = strlen(key);
+    st = &ct->stripes[hash_shard(hash_string(key, len), ct->nstripes)];
+    pthread_mutex_lock(&st->lock);
+    value = get_value(st->ht, key);
+    pthread_mutex_unlock(&st->lock);
+    return value;
+}
+
+
+int cht_add(concurrent_table *ct, char *key, int delta)
+{
+    unsigned long h;
+    stripe *st;
+    size_t len;
+    int value;
+
+    if (ct->mode == CHT_LOCK_FREE) {
+        return lock_free_add(ct, key, delta);
+    }
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    st = &ct->stripes[hash_shard(h, ct->nstripes)];
+    pthread_mutex_lock(&st->lock);
+    value = (*find_or_insert_hashed(st->ht, key, len, h) += delta);
+    pthread_mutex_unlock(&st->lock);
+    return value;
+}
+
+
+void cht_print(concurrent_table *ct)
+{
+    unsigned long j;
+    int i;
+
+    if (ct->mode == CHT_LOCK_FREE) {
+        for (j = 0; j <= ct->mask; j++) {
+            if (ct->slots[j].key != NULL) {
+                printf("%s %d\n", KEY_TEXT(ct->slots[j].key),
+                       ct->slots[j].value);
+            }
+        }
+    }
+    else {
+        for (i = 0; i < ct->nstripes; i++) {
+            print_hash_table(ct->stripes[i].ht);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: concurrent_table.h
+ *
+ *       Declaration of a word count table that many threads can update
+ *       and read at the same time.  Three synchronization schemes are
+ *       offered behind one interface so that they can be compared:
+ *
+ *       CHT_GLOBAL_LOCK: one hash_table guarded by a single mutex.
+ *
+ *       CHT_STRIPED:     the keys are split by hash into CHT_STRIPES
+ *                        hash_tables, each with its own mutex, so
+ *                        threads only contend on the same stripe.
+ *
+ *       CHT_LOCK_FREE:   one open addressing array whose slots are
+ *                        claimed with compare-and-swap and whose counts
+ *                        are updated with atomic adds.  No thread ever
+ *                        blocks, but the array cannot grow: it is sized
+ *                        from the capacity hint once and for all.
+ *
+ */
+
+#ifndef CONCURRENT_TABLE_H
+#define CONCURRENT_TABLE_H
+
+#define CHT_GLOBAL_LOCK 0
+#define CHT_STRIPED     1
+#define CHT_LOCK_FREE   2
+
+/* Number of stripes used by CHT_STRIPED tables. */
+#define CHT_STRIPES 64
+
+typedef struct _concurrent_table concurrent_table;
+
+/*
+ * Create an empty table using one of the schemes above.  A
+ * CHT_LOCK_FREE table holds at most 'capacity_hint' keys; for the other
+ * schemes the hint only presizes the table.
+ */
+concurrent_table *cht_create(int mode, unsigned long capacity_hint);
+
+/* Free a table.  No other thread may be using it. */
+void cht_free(concurrent_table *ct);
+
+/* Return the value stored at a key, or 0 if the key is not there. */
+int cht_get(concurrent_table *ct, char *key);
+
+/*
+ * Add 'delta' to the value stored at a key, inserting the key with a
+ * value of 0 first if needed, and return the new value.  For a
+ * CHT_LOCK_FREE table that is full, print an error and exit.
+ */
+int cht_add(concurrent_table *ct, char *key, int delta);
+
+/*
+ * Print out the contents of the table as key/value pairs.  No other
+ * thread may be updating it.
+ */
+void cht_print(concurrent_table *ct);
+
+#endif  /* CONCURRENT_TABLE_H */
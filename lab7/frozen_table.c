@@ -0,0 +1,412 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: frozen_table.c
+ *
+ *       Implementation of the frozen table file format.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "frozen_table.h"
+#include "word_output.h"
+#include "memcheck.h"
+
+#define FROZEN_MAGIC "WFROZE1"
+#define FROZEN_BYTE_ORDER 0x01020304UL
+
+/*
+ * Passes over the entries tried for a bucket before trying another
+ * seed, each with a different step between the keys of the bucket.
+ */
+#define FROZEN_ROUNDS 64
+
+/* Seeds tried before giving up. */
+#define FROZEN_SEEDS 16
+
+/* Names as in saved_table.c. */
+#define STRINGIFY(x) #x
+#define NAME_OF(x) STRINGIFY(x)
+#define HASH_NAME (NAME_OF(HASH_FUNC) + 5)
+
+/*
+ * The bucket of a hash, and the entry that displacement 'd' sends a key
+ * to from its two positions 'f1' and 'f2', both less than 'n': pass
+ * d / n over the entries steps by f2 and starts d % n further on.
+ */
+#define BUCKET(h, nbuckets) (hash_ulong(h) % (nbuckets))
+#define DISPLACED(f1, f2, d, n) \
+    (((f1) + (d) / (n) * (f2) % (n) + (d) % (n)) % (n))
+
+/* The displacements take a whole number of words on disk. */
+#define DISPLACE_BYTES(nbuckets) \
+    (((nbuckets) * sizeof(unsigned int) + sizeof(unsigned long) - 1) / \
+     sizeof(unsigned long) * sizeof(unsigned long))
+
+/* Nonzero if an entry's key lies inside the pool. */
+#define KEY_IN_POOL(ft, e) \
+    ((e)->key < (ft)->header->pool_size && \
+     (e)->len < (ft)->header->pool_size - (e)->key)
+
+
+int displace_buckets(unsigned long *f1, unsigned long *f2,
+                     unsigned long *members, unsigned long *first,
+                     unsigned long *order, unsigned long nbuckets,
+                     unsigned long n, unsigned int *displace,
+                     unsigned long *word_of);
+
+
+/*
+ * Find a displacement for each bucket, largest bucket first, while the
+ * entries are emptiest.  The keys of bucket b are members[first[b]] up
+ * to members[first[b + 1]], and 'order' lists the buckets largest
+ * first.  Set word_of[e] to the key sent to entry e and return 0, or
+ * return -1 if some bucket fits nowhere.
+ *
+ * A displacement is tried as a pass, which fixes where the keys of the
+ * bucket lie relative to each other, and a shift of them all, so each
+ * try costs a few additions.  A bucket of one key takes the next free
+ * entry in the first pass.
+ */
+int displace_buckets(unsigned long *f1, unsigned long *f2,
+                     unsigned long *members, unsigned long *first,
+                     unsigned long *order, unsigned long nbuckets,
+                     unsigned long n, unsigned int *displace,
+                     unsigned long *word_of)
+{
+    unsigned long *base;
+    unsigned long rounds, pass, shift, size, b, i, j, k, m, p;
+    char *taken;
+
+    /* One more than needed, as there may be no keys at all. */
+    taken = (char *) calloc(n + 1, 1);
+    base = (unsigned long *) malloc(
+        (first[order[0] + 1] - first[order[0]] + 1) * sizeof(unsigned long));
+    if (taken == NULL || base == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    rounds = (n <= UINT_MAX / FROZEN_ROUNDS) ? FROZEN_ROUNDS : UINT_MAX / n;
+
+    for (i = 0; i < nbuckets; i++) {
+        b = order[i];
+        size = first[b + 1] - first[b];
+        if (size == 0) {
+            continue;
+        }
+        for (pass = 0; pass < rounds; pass++) {
+            /* The keys' entries in this pass must differ... */
+            for (j = 0; j < size; j++) {
+                m = members[first[b] + j];
+                base[j] = (f1[m] + pass * f2[m] % n) % n;
+                for (k = 0; k < j && base[k] != base[j]; k++) {
+                    /* Keep comparing. */
+                }
+                if (k < j) {
+                    break;
+                }
+            }
+            if (j < size) {
+                continue;
+            }
+
+            /* ...and some shift must make them all free. */
+            for (shift = 0; shift < n; shift++) {
+                for (j = 0; j < size; j++) {
+                    p = base[j] + shift;
+                    if (taken[p < n ? p : p - n]) {
+                        break;
+                    }
+                }
+                if (j == size) {
+                    break;
+                }
+            }
+            if (shift < n) {
+                break;
+            }
+        }
+        if (pass == rounds) {
+            free(base);
+            free(taken);
+            return -1;
+        }
+
+        displace[b] = (unsigned int) (pass * n + shift);
+        for (j = 0; j < size; j++) {
+            p = base[j] + shift;
+            p = p < n ? p : p - n;
+            taken[p] = 1;
+            word_of[p] = members[first[b] + j];
+        }
+    }
+
+    free(base);
+    free(taken);
+    return 0;
+}
+
+
+/*
+ * The file is written under a temporary name and renamed into place
+ * when complete, as in save_hash_tables().  The pool holds the keys in
+ * entry order.
+ */
+int freeze_hash_tables(hash_table **tables, int ntables,
+                       const char *filename)
+{
+    frozen_header header;
+    frozen_entry *entries;
+    word_count *words;
+    unsigned long *hashes, *f1, *f2, *members, *first, *order, *by_size;
+    unsigned long *word_of;
+    unsigned int *displace;
+    unsigned long n, nbuckets, size, max_size, seed, i, j, k, b, f;
+    unsigned long offset;
+    size_t len;
+    char *tmpname;
+    FILE *out;
+    int ok;
+
+    words = gather_hash_tables(tables, ntables, &n);
+    nbuckets = n / FROZEN_LAMBDA + 1;
+
+    /* One more key than needed, as there may be none at all. */
+    hashes = (unsigned long *) malloc((n + 1) * sizeof(unsigned long));
+    f1 = (unsigned long *) malloc((n + 1) * sizeof(unsigned long));
+    f2 = (unsigned long *) malloc((n + 1) * sizeof(unsigned long));
+    members = (unsigned long *) malloc((n + 1) * sizeof(unsigned long));
+    word_of = (unsigned long *) malloc((n + 1) * sizeof(unsigned long));
+    first = (unsigned long *) malloc((nbuckets + 1) * sizeof(unsigned long));
+    order = (unsigned long *) malloc(nbuckets * sizeof(unsigned long));
+    displace = (unsigned int *) calloc(1, DISPLACE_BYTES(nbuckets));
+    if (hashes == NULL || f1 == NULL || f2 == NULL || members == NULL ||
+        word_of == NULL || first == NULL || order == NULL ||
+        displace == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    /*
+     * List the keys of each bucket together with a counting sort: count
+     * them, place them with first[b] as a cursor, which leaves it at the
+     * start of the next bucket, and shift the starts back into place.
+     */
+    memset(first, 0, (nbuckets + 1) * sizeof(unsigned long));
+    for (i = 0; i < n; i++) {
+        hashes[i] = hash_string(words[i].key, strlen(words[i].key));
+        first[BUCKET(hashes[i], nbuckets) + 1]++;
+    }
+    max_size = 0;
+    for (b = 0; b < nbuckets; b++) {
+        if (first[b + 1] > max_size) {
+            max_size = first[b + 1];
+        }
+        first[b + 1] += first[b];
+    }
+    for (i = 0; i < n; i++) {
+        members[first[BUCKET(hashes[i], nbuckets)]++] = i;
+    }
+    for (b = nbuckets; b > 0; b--) {
+        first[b] = first[b - 1];
+    }
+    first[0] = 0;
+
+    /* Order the buckets largest first, with another counting sort. */
+    by_size = (unsigned long *) calloc(max_size + 1, sizeof(unsigned long));
+    if (by_size == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    for (b = 0; b < nbuckets; b++) {
+        by_size[first[b + 1] - first[b]]++;
+    }
+    for (i = 0, size = max_size + 1; size > 0; size--) {
+        f = by_size[size - 1];
+        by_size[size - 1] = i;
+        i += f;
+    }
+    for (b = 0; b < nbuckets; b++) {
+        order[by_size[first[b + 1] - first[b]]++] = b;
+    }
+
+    /* Keys of the same full hash always land together. */
+    ok = 1;
+    for (b = 0; ok && b < nbuckets; b++) {
+        for (j = first[b]; ok && j < first[b + 1]; j++) {
+            for (k = first[b]; k < j; k++) {
+                if (hashes[members[k]] == hashes[members[j]]) {
+                    ok = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* A failed seed leaves some bucket with nowhere to go; try another. */
+    for (seed = 0; ok && seed < FROZEN_SEEDS; seed++) {
+        for (i = 0; i < n; i++) {
+            f = hash_ulong(hashes[i] ^ seed);
+            f1[i] = f % n;
+            f2[i] = f / n % n;
+        }
+        if (displace_buckets(f1, f2, members, first, order, nbuckets, n,
+                             displace, word_of) == 0) {
+            break;
+        }
+    }
+    ok = ok && seed < FROZEN_SEEDS;
+
+    /* Lay the entries out in place, and their keys after a zero byte. */
+    entries = (frozen_entry *) malloc((n + 1) * sizeof(frozen_entry));
+    tmpname = (char *) malloc(strlen(filename) + 5);
+    if (entries == NULL || tmpname == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    offset = 1;
+    for (i = 0; ok && i < n; i++) {
+        len = strlen(words[word_of[i]].key);
+        entries[i].hash = hashes[word_of[i]];
+        entries[i].key = offset;
+        entries[i].len = (unsigned int) len;
+        entries[i].value = words[word_of[i]].value;
+        offset += len + 1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC));
+    header.byte_order = FROZEN_BYTE_ORDER;
+    header.nkeys = n;
+    header.nbuckets = nbuckets;
+    header.seed = seed;
+    header.pool_size = offset;
+    strncpy(header.hash_name, HASH_NAME, sizeof(header.hash_name) - 1);
+
+    sprintf(tmpname, "%s.tmp", filename);
+    out = ok ? fopen(tmpname, "wb") : NULL;
+    ok = out != NULL;
+    if (ok) {
+        fwrite(&header, sizeof(header), 1, out);
+        fwrite(displace, 1, DISPLACE_BYTES(nbuckets), out);
+        fwrite(entries, sizeof(frozen_entry), n, out);
+        fputc('\0', out);
+        for (i = 0; i < n; i++) {
+            fwrite(words[word_of[i]].key, 1, entries[i].len + 1, out);
+        }
+        ok = !ferror(out);
+        ok = fclose(out) == 0 && ok;
+        ok = ok && rename(tmpname, filename) == 0;
+        if (!ok) {
+            remove(tmpname);
+        }
+    }
+
+    free(tmpname);
+    free(entries);
+    free(by_size);
+    free(displace);
+    free(order);
+    free(first);
+    free(word_of);
+    free(members);
+    free(f2);
+    free(f1);
+    free(hashes);
+    free(words);
+    return ok ? 0 : -1;
+}
+
+
+int open_frozen_table(frozen_table *ft, const char *filename)
+{
+    const frozen_header *header;
+    struct stat sb;
+    void *map;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &sb) != 0 ||
+        (size_t) sb.st_size < sizeof(frozen_header)) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    /* Check that the header describes this file exactly. */
+    header = (const frozen_header *) map;
+    ft->map = map;
+    ft->size = (size_t) sb.st_size;
+    ft->header = header;
+    ft->hash = NULL;
+    if (memcmp(header->magic, FROZEN_MAGIC, sizeof(FROZEN_MAGIC)) == 0 &&
+        header->byte_order == FROZEN_BYTE_ORDER &&
+        header->nbuckets > 0 &&
+        header->nbuckets <= ft->size / sizeof(unsigned int) &&
+        header->nkeys <= ft->size / sizeof(frozen_entry) &&
+        header->pool_size > 0 &&
+        ft->size == sizeof(frozen_header) +
+                    DISPLACE_BYTES(header->nbuckets) +
+                    header->nkeys * sizeof(frozen_entry) +
+                    header->pool_size &&
+        memchr(header->hash_name, '\0', sizeof(header->hash_name))) {
+        ft->hash = find_hash_fn(header->hash_name);
+    }
+    if (ft->hash == NULL) {
+        munmap(map, ft->size);
+        return -1;
+    }
+
+    ft->displace = (const unsigned int *) (header + 1);
+    ft->entries = (const frozen_entry *)
+        ((const char *) ft->displace + DISPLACE_BYTES(header->nbuckets));
+    ft->pool = (const char *) (ft->entries + header->nkeys);
+    return 0;
+}
+
+
+int frozen_get(const frozen_table *ft, const char *key, size_t len)
+{
+    const frozen_entry *e;
+    unsigned long h, f, n, d;
+
+    n = ft->header->nkeys;
+    if (n == 0) {
+        return 0;
+    }
+    h = ft->hash(key, len);
+    d = ft->displace[BUCKET(h, ft->header->nbuckets)];
+    f = hash_ulong(h ^ ft->header->seed);
+    e = &ft->entries[DISPLACED(f % n, f / n % n, d, n)];
+    if (e->hash == h && e->len == len && KEY_IN_POOL(ft, e) &&
+        !memcmp(ft->pool + e->key, key, len)) {
+        return e->value;
+    }
+    return 0;
+}
+
+
+void close_frozen_table(frozen_table *ft)
+{
+    munmap(ft->map, ft->size);
+}
@@ -0,0 +1,91 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: frozen_table.h
+ *
+ *       Declaration of a frozen table: a final count compiled into a
+ *       file for read only lookups, with no probing at all.
+ *
+ *       Freezing builds a minimal perfect hash over the key set with
+ *       the CHD algorithm (hash, displace and compress): keys are
+ *       spread over buckets of about FROZEN_LAMBDA keys, and each
+ *       bucket gets a displacement that sends all of its keys to free
+ *       slots of a dense array of exactly as many entries as keys.  A
+ *       lookup hashes the key once, reads its bucket's displacement and
+ *       then the one entry that can hold the key, whose hash and key
+ *       are compared to turn away words that were never counted.
+ *
+ *       As with a saved table (saved_table.h), entries refer to keys by
+ *       their offset in a pool, the header names the hash function, and
+ *       the file is mapped and used exactly as it lies on disk.  Files
+ *       are not portable between machines with different byte orders
+ *       or word sizes.
+ *
+ */
+
+#ifndef FROZEN_TABLE_H
+#define FROZEN_TABLE_H
+
+#include <stddef.h>
+#include "hash_table.h"
+#include "hash_func.h"
+
+/* Average number of keys in a bucket. */
+#define FROZEN_LAMBDA 4
+
+/* A file header, as it lies on disk. */
+typedef struct
+{
+    char magic[8];              /* FROZEN_MAGIC */
+    unsigned long byte_order;   /* FROZEN_BYTE_ORDER as written */
+    unsigned long nkeys;        /* also the number of entries */
+    unsigned long nbuckets;
+    unsigned long seed;         /* of the displaced positions */
+    unsigned long pool_size;    /* bytes of keys */
+    char hash_name[16];         /* as known to find_hash_fn() */
+} frozen_header;
+
+/* An entry, as it lies on disk. */
+typedef struct
+{
+    unsigned long hash;
+    unsigned long key;          /* offset of the key in the pool */
+    unsigned int len;
+    int value;
+} frozen_entry;
+
+/* An open frozen table. */
+typedef struct
+{
+    void *map;
+    size_t size;
+    const frozen_header *header;
+    const unsigned int *displace;   /* one per bucket */
+    const frozen_entry *entries;
+    const char *pool;
+    hash_fn hash;               /* the function the keys were hashed by */
+} frozen_table;
+
+/*
+ * Freeze the words of 'ntables' tables, whose key sets must be
+ * disjoint (such as the shards of parallel_count()), into
+ * 'filename'.  Return 0 on success or -1 if the file cannot be
+ * written, or if two keys have the same full hash, which no
+ * displacement can separate.
+ */
+int freeze_hash_tables(hash_table **tables, int ntables,
+                       const char *filename);
+
+/*
+ * Map a frozen table for reading.  Return 0 on success or -1 if the
+ * file cannot be mapped or is not a valid frozen table.
+ */
+int open_frozen_table(frozen_table *ft, const char *filename);
+
+/* Return the count of the 'len' bytes at 'key', or 0 if there is none. */
+int frozen_get(const frozen_table *ft, const char *key, size_t len);
+
+/* Unmap a frozen table. */
+void close_frozen_table(frozen_table *ft);
+
+#endif  /* FROZEN_TABLE_H */
@@ -0,0 +1,318 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: gen_corpus.c
+ *
+ *       Generate a benchmark corpus for the word counter: words drawn
+ *       from a vocabulary with Zipf's law, as in natural text, where the
+ *       word of rank r (from 1) is drawn with a probability proportional
+ *       to 1 / r^s.
+ *
+ *       The word of rank r is spelled from the digits of r in bijective
+ *       base 26 ("a" to "z", then "aa" and so on), padded with as many
+ *       pseudo random letters again, so common words are short and rare
+ *       ones long, and no two ranks share a spelling.  Words are drawn
+ *       in O(1) each with Walker's alias method, and the output for a
+ *       given seed is always the same.
+ *
+ *       The corpus is written in lines of WORDS_PER_LINE words until it
+ *       reaches the requested size, and the number of words is printed.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "hash_func.h"
+#include "memcheck.h"
+
+/* Words on each line of the corpus. */
+#define WORDS_PER_LINE 12
+
+/* Size of the output buffer. */
+#define OUTPUT_BUFFER (1024 * 1024)
+
+/* Room for the longest word, a separator and a newline. */
+#define MAX_WORD 64
+
+/* Defaults for the options. */
+#define DEFAULT_VOCABULARY 200000
+#define DEFAULT_EXPONENT 1.0
+#define DEFAULT_SEED 11
+
+
+/*
+ * An alias table for drawing ranks: pick a column i uniformly, then
+ * keep i with probability prob[i], or take alias[i] otherwise.
+ */
+
+typedef struct
+{
+    double *prob;
+    unsigned long *alias;
+    unsigned long n;
+} alias_table;
+
+
+int parse_size(const char *s, double *size);
+void build_alias_table(alias_table *at, unsigned long n, double exponent);
+unsigned long draw_rank(alias_table *at, unsigned long *state);
+size_t spell_word(unsigned long rank, char *out);
+void write_or_exit(const char *buf, size_t n, FILE *f, char *filename);
+void free_alias_table(alias_table *at);
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [-v vocabulary] [-z exponent] [-r seed] "
+            "size filename\n", progname);
+    fprintf(stderr, "    size: bytes to write, with an optional K, M "
+            "or G suffix\n");
+    fprintf(stderr, "    -v: number of distinct words (default %d)\n",
+            DEFAULT_VOCABULARY);
+    fprintf(stderr, "    -z: Zipf exponent (default %.1f)\n",
+            DEFAULT_EXPONENT);
+    fprintf(stderr, "    -r: random seed (default %d)\n", DEFAULT_SEED);
+}
+
+
+/*
+ * Parse a size such as "100", "64K", "10M" or "10G" (powers of 1024).
+ * Return 0, or -1 if 's' is not a size.
+ */
+int parse_size(const char *s, double *size)
+{
+    char *end;
+
+    *size = strtod(s, &end);
+    if (end == s || *size <= 0) {
+        return -1;
+    }
+    switch (*end) {
+    case 'G':
+        *size *= 1024;
+        /* Fall through. */
+    case 'M':
+        *size *= 1024;
+        /* Fall through. */
+    case 'K':
+        *size *= 1024;
+        end++;
+        break;
+    default:
+        break;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+
+/*
+ * Build the alias table of a Zipf distribution over 'n' ranks with
+ * Vose's algorithm: scale the probabilities so that they average 1,
+ * then repeatedly fill up a column below 1 from one above 1.  The
+ * columns below 1 are listed at the front of 'work' and the others at
+ * the back; there are never more than 'n' of them in all.
+ */
+void build_alias_table(alias_table *at, unsigned long n, double exponent)
+{
+    unsigned long *work;
+    unsigned long nsmall, nlarge, i, s, l;
+    double total;
+
+    at->n = n;
+    at->prob = (double *) malloc(n * sizeof(double));
+    at->alias = (unsigned long *) malloc(n * sizeof(unsigned long));
+    work = (unsigned long *) malloc(n * sizeof(unsigned long));
+    if (at->prob == NULL || at->alias == NULL || work == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    total = 0;
+    for (i = 0; i < n; i++) {
+        at->prob[i] = pow((double) (i + 1), -exponent);
+        total += at->prob[i];
+    }
+
+    nsmall = nlarge = 0;
+    for (i = 0; i < n; i++) {
+        at->prob[i] *= n / total;
+        if (at->prob[i] < 1.0) {
+            work[nsmall++] = i;
+        }
+        else {
+            work[n - 1 - nlarge++] = i;
+        }
+    }
+
+    /* Each step finishes one small column with part of a large one. */
+    while (nsmall > 0 && nlarge > 0) {
+        s = work[--nsmall];
+        l = work[n - nlarge];
+        at->alias[s] = l;
+        at->prob[l] -= 1.0 - at->prob[s];
+        if (at->prob[l] < 1.0) {
+            nlarge--;
+            work[nsmall++] = l;
+        }
+    }
+
+    /* What is left is 1 up to rounding. */
+    while (nlarge > 0) {
+        l = work[n - nlarge--];
+        at->prob[l] = 1.0;
+        at->alias[l] = l;
+    }
+    while (nsmall > 0) {
+        s = work[--nsmall];
+        at->prob[s] = 1.0;
+        at->alias[s] = s;
+    }
+
+    free(work);
+}
+
+
+/* Draw a rank, from 0, advancing the generator 'state'. */
+unsigned long draw_rank(alias_table *at, unsigned long *state)
+{
+    unsigned long i;
+    double u;
+
+    u = hash_ulong((*state)++) / (ULONG_MAX + 1.0) * at->n;
+    i = (unsigned long) u;
+    if (i >= at->n) {
+        i = at->n - 1;
+    }
+    return (u - i < at->prob[i]) ? i : at->alias[i];
+}
+
+
+/*
+ * Spell the word of a rank (from 0) into 'out' and return its length.
+ * The first half of the word gives the rank and its length, so the
+ * padding can be anything.
+ */
+size_t spell_word(unsigned long rank, char *out)
+{
+    unsigned long r, pad;
+    size_t n, i;
+
+    n = 0;
+    for (r = rank + 1; r > 0; r = (r - 1) / 26) {
+        out[n++] = (char) ('a' + (r - 1) % 26);
+    }
+
+    pad = hash_ulong(rank);
+    for (i = 0; i < n; i++) {
+        out[n + i] = (char) ('a' + pad % 26);
+        pad /= 26;
+    }
+    return 2 * n;
+}
+
+
+/* Write 'n' bytes to the output file, or exit. */
+void write_or_exit(const char *buf, size_t n, FILE *f, char *filename)
+{
+    if (fwrite(buf, 1, n, f) != n) {
+        fprintf(stderr, "Cannot write \"%s\"! Terminating program.\n",
+                filename);
+        exit(1);
+    }
+}
+
+
+void free_alias_table(alias_table *at)
+{
+    free(at->prob);
+    free(at->alias);
+}
+
+
+int main(int argc, char **argv)
+{
+    alias_table at;
+    unsigned long vocabulary, state, nwords;
+    double exponent, size, written;
+    char *buf, *filename;
+    size_t used;
+    FILE *f;
+    int i;
+
+    vocabulary = DEFAULT_VOCABULARY;
+    exponent = DEFAULT_EXPONENT;
+    state = DEFAULT_SEED;
+    for (i = 1; i + 2 < argc; i += 2) {
+        if (!strcmp(argv[i], "-v")) {
+            vocabulary = strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-z")) {
+            exponent = atof(argv[i + 1]);
+        }
+        else if (!strcmp(argv[i], "-r")) {
+            state = strtoul(argv[i + 1], NULL, 10);
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 2 != argc || vocabulary == 0 || exponent < 0 ||
+        parse_size(argv[i], &size) != 0) {
+        usage(argv[0]);
+        exit(1);
+    }
+    filename = argv[i + 1];
+
+    f = fopen(filename, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot write \"%s\"! Terminating program.\n",
+                filename);
+        exit(1);
+    }
+
+    /* Draws hash a counter, which different seeds start far apart. */
+    state = hash_ulong(state);
+    build_alias_table(&at, vocabulary, exponent);
+    buf = (char *) malloc(OUTPUT_BUFFER);
+    if (buf == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    used = 0;
+    written = 0;
+    nwords = 0;
+    while (written + used < size) {
+        used += spell_word(draw_rank(&at, &state), buf + used);
+        nwords++;
+        buf[used++] = (nwords % WORDS_PER_LINE == 0) ? '\n' : ' ';
+
+        if (used + MAX_WORD > OUTPUT_BUFFER) {
+            write_or_exit(buf, used, f, filename);
+            written += used;
+            used = 0;
+        }
+    }
+    if (used > 0) {
+        buf[used - 1] = '\n';
+    }
+    write_or_exit(buf, used, f, filename);
+
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Cannot write \"%s\"! Terminating program.\n",
+                filename);
+        exit(1);
+    }
+
+    printf("%lu words\n", nwords);
+
+    free(buf);
+    free_alias_table(&at);
+    print_memory_leaks();
+    return 0;
+}
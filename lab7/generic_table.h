@@ -0,0 +1,255 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: generic_table.h
+ *
+ *       Macros that generate an open addressing hash table for any key
+ *       and value types.  Each instance is ordinary C code written for
+ *       its own types, so keys and values are stored by value in the
+ *       slots and the hash, compare and copy operations are expanded in
+ *       place, with no void pointers or function pointers in between.
+ *
+ *       GENERIC_TABLE_DECLARE(name, key_type, value_type) goes in a
+ *       header and declares the types and functions below.
+ *
+ *       GENERIC_TABLE_DEFINE(name, key_type, value_type, HASH, EQUAL,
+ *       COPY) goes in exactly one source file, after memcheck.h, and
+ *       defines the functions.  HASH(k), EQUAL(a, b) and COPY(t, k) are
+ *       the names of macros (or functions) that hash a key to an
+ *       unsigned long, compare two keys, and make the copy of a new key
+ *       that the table keeps.  COPY may allocate from the table's arena
+ *       't->keys', which is freed with the table; keys that need no
+ *       copy use GT_NO_COPY.
+ *
+ *       For a table called 'name' the functions are:
+ *
+ *       name *name_create(unsigned long capacity_hint);
+ *       void name_free(name *t);
+ *       unsigned long name_size(name *t);
+ *
+ *       value_type *name_find(name *t, key_type key);
+ *           Return a pointer to the key's value, or NULL.
+ *
+ *       value_type *name_find_or_insert(name *t, key_type key);
+ *           The same, but a missing key is inserted first, with its
+ *           value set to all zero bytes.
+ *
+ *       int name_remove(name *t, key_type key);
+ *           Return 1 if the key was found and removed, otherwise 0.
+ *
+ *       int name_next(name *t, unsigned long *pos, key_type *key,
+ *                     value_type **value);
+ *           Iterate: start with *pos = 0, and each call returns 1 and
+ *           the next key and value, or 0 at the end.
+ *
+ *       Value pointers stay valid until the table is next modified.
+ *
+ */
+
+#ifndef GENERIC_TABLE_H
+#define GENERIC_TABLE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/* A COPY operation for keys that are stored as they are. */
+#define GT_NO_COPY(t, k) (k)
+
+/* A slot whose hash is GT_EMPTY is unused; real hashes are moved off it. */
+#define GT_EMPTY 0UL
+#define GT_NONEMPTY(h) ((h) + ((h) == GT_EMPTY))
+
+/* The table grows when it would be more than 3/4 full. */
+#define GT_MIN_CAPACITY 8UL
+#define GT_FULL(count, mask) (4 * (count) > 3 * ((mask) + 1))
+
+
+#define GENERIC_TABLE_DECLARE(name, key_type, value_type)                  \
+                                                                           \
+typedef struct                                                             \
+{                                                                          \
+    unsigned long hash;                                                    \
+    key_type key;                                                          \
+    value_type value;                                                      \
+} name##_slot;                                                             \
+                                                                           \
+typedef struct                                                             \
+{                                                                          \
+    name##_slot *slots;                                                    \
+    unsigned long mask;         /* capacity - 1 */                         \
+    unsigned long count;                                                   \
+    arena keys;                 /* storage for COPY */                     \
+} name;                                                                    \
+                                                                           \
+name *name##_create(unsigned long capacity_hint);                          \
+void name##_free(name *t);                                                 \
+unsigned long name##_size(name *t);                                        \
+value_type *name##_find(name *t, key_type key);                            \
+value_type *name##_find_or_insert(name *t, key_type key);                  \
+int name##_remove(name *t, key_type key);                                  \
+int name##_next(name *t, unsigned long *pos, key_type *key,                \
+                value_type **value);
+
+
+#define GENERIC_TABLE_DEFINE(name, key_type, value_type, HASH, EQUAL, COPY) \
+                                                                           \
+static name##_slot *name##_alloc_slots(unsigned long capacity)             \
+{                                                                          \
+    name##_slot *slots;                                                    \
+                                                                           \
+    slots = (name##_slot *) calloc(capacity, sizeof(name##_slot));         \
+    if (slots == NULL) {                                                   \
+        fprintf(stderr, "Fatal error: out of memory. "                     \
+                "Terminating program.\n");                                 \
+        exit(1);                                                           \
+    }                                                                      \
+    return slots;                                                          \
+}                                                                          \
+                                                                           \
+/* Return the key's slot, or the empty slot that ends its probe run. */    \
+static name##_slot *name##_probe(name *t, key_type key, unsigned long h)   \
+{                                                                          \
+    unsigned long i;                                                       \
+                                                                           \
+    for (i = h & t->mask; t->slots[i].hash != GT_EMPTY;                    \
+         i = (i + 1) & t->mask) {                                          \
+        if (t->slots[i].hash == h && EQUAL(t->slots[i].key, key)) {        \
+            break;                                                         \
+        }                                                                  \
+    }                                                                      \
+    return &t->slots[i];                                                   \
+}                                                                          \
+                                                                           \
+/* Double the capacity, reusing the stored hashes. */                      \
+static void name##_grow(name *t)                                           \
+{                                                                          \
+    name##_slot *old;                                                      \
+    unsigned long old_mask, i, j;                                          \
+                                                                           \
+    old = t->slots;                                                        \
+    old_mask = t->mask;                                                    \
+    t->mask = 2 * old_mask + 1;                                            \
+    t->slots = name##_alloc_slots(t->mask + 1);                            \
+    for (i = 0; i <= old_mask; i++) {                                      \
+        if (old[i].hash != GT_EMPTY) {                                     \
+            for (j = old[i].hash & t->mask; t->slots[j].hash != GT_EMPTY;  \
+                 j = (j + 1) & t->mask) {                                  \
+                /* Keep probing. */                                        \
+            }                                                              \
+            t->slots[j] = old[i];                                          \
+        }                                                                  \
+    }                                                                      \
+    free(old);                                                             \
+}                                                                          \
+                                                                           \
+name *name##_create(unsigned long capacity_hint)                           \
+{                                                                          \
+    name *t;                                                               \
+    unsigned long capacity;                                                \
+                                                                           \
+    t = (name *) malloc(sizeof(name));                                     \
+    if (t == NULL) {                                                       \
+        fprintf(stderr, "Fatal error: out of memory. "                     \
+                "Terminating program.\n");                                 \
+        exit(1);                                                           \
+    }                                                                      \
+    capacity = GT_MIN_CAPACITY;                                            \
+    while (GT_FULL(capacity_hint, capacity - 1)) {                         \
+        capacity *= 2;                                                     \
+    }                                                                      \
+    t->slots = name##_alloc_slots(capacity);                               \
+    t->mask = capacity - 1;                                                \
+    t->count = 0;                                                          \
+    arena_init(&t->keys);                                                  \
+    return t;                                                              \
+}                                                                          \
+                                                                           \
+void name##_free(name *t)                                                  \
+{                                                                          \
+    arena_free(&t->keys);                                                  \
+    free(t->slots);                                                        \
+    free(t);                                                               \
+}                                                                          \
+                                                                           \
+unsigned long name##_size(name *t)                                         \
+{                                                                          \
+    return t->count;                                                       \
+}                                                                          \
+                                                                           \
+value_type *name##_find(name *t, key_type key)                             \
+{                                                                          \
+    name##_slot *s;                                                        \
+    unsigned long h;                                                       \
+                                                                           \
+    h = HASH(key);                                                         \
+    s = name##_probe(t, key, GT_NONEMPTY(h));                              \
+    return s->hash != GT_EMPTY ? &s->value : NULL;                         \
+}                                                                          \
+                                                                           \
+value_type *name##_find_or_insert(name *t, key_type key)                   \
+{                                                                          \
+    name##_slot *s;                                                        \
+    unsigned long h;                                                       \
+                                                                           \
+    h = HASH(key);                                                         \
+    h = GT_NONEMPTY(h);                                                    \
+    s = name##_probe(t, key, h);                                           \
+    if (s->hash != GT_EMPTY) {                                             \
+        return &s->value;                                                  \
+    }                                                                      \
+    if (GT_FULL(t->count + 1, t->mask)) {                                  \
+        name##_grow(t);                                                    \
+        s = name##_probe(t, key, h);                                       \
+    }                                                                      \
+    s->hash = h;                                                           \
+    s->key = COPY(t, key);                                                 \
+    memset(&s->value, 0, sizeof(s->value));                                \
+    t->count++;                                                            \
+    return &s->value;                                                      \
+}                                                                          \
+                                                                           \
+/* Shift later slots of the run back, as in oa_hash_table.c. */            \
+int name##_remove(name *t, key_type key)                                   \
+{                                                                          \
+    name##_slot *s;                                                        \
+    unsigned long h, i, j, home;                                           \
+                                                                           \
+    h = HASH(key);                                                         \
+    s = name##_probe(t, key, GT_NONEMPTY(h));                              \
+    if (s->hash == GT_EMPTY) {                                             \
+        return 0;                                                          \
+    }                                                                      \
+    i = (unsigned long) (s - t->slots);                                    \
+    j = i;                                                                 \
+    while (1) {                                                            \
+        j = (j + 1) & t->mask;                                             \
+        if (t->slots[j].hash == GT_EMPTY) {                                \
+            break;                                                         \
+        }                                                                  \
+        home = t->slots[j].hash & t->mask;                                 \
+        if (((j - home) & t->mask) >= ((j - i) & t->mask)) {               \
+            t->slots[i] = t->slots[j];                                     \
+            i = j;                                                         \
+        }                                                                  \
+    }                                                                      \
+    t->slots[i].hash = GT_EMPTY;                                           \
+    t->count--;                                                            \
+    return 1;                                                              \
+}                                                                          \
+                                                                           \
+int name##_next(name *t, unsigned long *pos, key_type *key,                \
+                value_type **value)                                        \
+{                                                                          \
+    for (; *pos <= t->mask; (*pos)++) {                                    \
+        if (t->slots[*pos].hash != GT_EMPTY) {                             \
+            *key = t->slots[*pos].key;                                     \
+            *value = &t->slots[(*pos)++].value;                            \
+            return 1;                                                      \
+        }                                                                  \
+    }                                                                      \
+    return 0;                                                              \
+}
+
+#endif  /* GENERIC_TABLE_H */
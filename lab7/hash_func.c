@@ -0,0 +1,189 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_func.c
+ *
+ *       Implementation of the string hash functions.  The word based
+ *       functions use 64 bit constants where unsigned long is 64 bits
+ *       wide and 32 bit constants elsewhere; results differ between the
+ *       two, and between byte orders, which is fine for an in memory
+ *       table.
+ *
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "hash_func.h"
+
+#if ULONG_MAX > 0xffffffffUL
+#define WORD_BITS  64
+#define FNV_OFFSET 0xcbf29ce484222325UL
+#define FNV_PRIME  0x100000001b3UL
+#define MIX_K1     0x9e3779b97f4a7c15UL
+#define MIX_K2     0xbf58476d1ce4e5b9UL
+#define MIX_K3     0x94d049bb133111ebUL
+#define MIX_ROT    31
+#define FMIX_S1    30
+#define FMIX_S2    27
+#define FMIX_S3    31
+#else
+#define WORD_BITS  32
+#define FNV_OFFSET 2166136261UL
+#define FNV_PRIME  16777619UL
+#define MIX_K1     0x9e3779b9UL
+#define MIX_K2     0x85ebca6bUL
+#define MIX_K3     0xc2b2ae35UL
+#define MIX_ROT    13
+#define FMIX_S1    16
+#define FMIX_S2    13
+#define FMIX_S3    16
+#endif
+
+#define WORD_BYTES sizeof(unsigned long)
+
+/* Number of accumulators used by hash_lanes. */
+#define NLANES 4
+
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (WORD_BITS - (r))))
+
+
+/*
+ * Function prototypes for private utilities.
+ */
+
+unsigned long load_word(const char *p, size_t n);
+unsigned long fmix(unsigned long h);
+unsigned long mix_words(unsigned long h, const char *s, size_t len);
+
+
+/*** Private utilities. ***/
+
+/*
+ * Load 'n' (at most WORD_BYTES) bytes starting at 'p' into a word,
+ * filling the rest with zeros.  memcpy keeps unaligned loads legal.
+ */
+unsigned long load_word(const char *p, size_t n)
+{
+    unsigned long w = 0;
+
+    memcpy(&w, p, n);
+    return w;
+}
+
+
+/* Final avalanche: every input bit affects every output bit. */
+unsigned long fmix(unsigned long h)
+{
+    h ^= h >> FMIX_S1;
+    h *= MIX_K2;
+    h ^= h >> FMIX_S2;
+    h *= MIX_K3;
+    h ^= h >> FMIX_S3;
+    return h;
+}
+
+
+/* Fold the words of 's' into the state 'h' and finish the hash. */
+unsigned long mix_words(unsigned long h, const char *s, size_t len)
+{
+    while (len >= WORD_BYTES) {
+        h ^= load_word(s, WORD_BYTES) * MIX_K2;
+        h = ROTL(h, MIX_ROT) * MIX_K1;
+        s += WORD_BYTES;
+        len -= WORD_BYTES;
+    }
+    if (len > 0) {
+        h ^= load_word(s, len) * MIX_K2;
+        h = ROTL(h, MIX_ROT) * MIX_K1;
+    }
+    return fmix(h);
+}
+
+
+/*** Hash functions. ***/
+
+unsigned long hash_bytesum(const char *s, size_t len)
+{
+    unsigned long count = 0;
+
+    while (len-- > 0) {
+        count += (unsigned char) *s++;
+    }
+    return count;
+}
+
+
+unsigned long hash_fnv1a(const char *s, size_t len)
+{
+    unsigned long h = FNV_OFFSET;
+
+    while (len-- > 0) {
+        h ^= (unsigned char) *s++;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+
+unsigned long hash_words(const char *s, size_t len)
+{
+    return mix_words(MIX_K1 ^ len, s, len);
+}
+
+
+unsigned long hash_lanes(const char *s, size_t len)
+{
+    unsigned long lane[NLANES];
+    unsigned long h;
+    size_t total;
+    int i;
+
+    if (len < NLANES * WORD_BYTES) {
+        return hash_words(s, len);
+    }
+
+    total = len;
+    for (i = 0; i < NLANES; i++) {
+        lane[i] = MIX_K1 * (unsigned long) (i + 1);
+    }
+
+    /* The lanes never depend on each other inside this loop. */
+    while (len >= NLANES * WORD_BYTES) {
+        for (i = 0; i < NLANES; i++) {
+            lane[i] += load_word(s + i * WORD_BYTES, WORD_BYTES) * MIX_K2;
+            lane[i] = ROTL(lane[i], MIX_ROT) * MIX_K1;
+        }
+        s += NLANES * WORD_BYTES;
+        len -= NLANES * WORD_BYTES;
+    }
+
+    h = ROTL(lane[0], 1) + ROTL(lane[1], 7) +
+        ROTL(lane[2], 12) + ROTL(lane[3], 18);
+    return mix_words(h ^ total, s, len);
+}
+
+
+/* Spread an integer key over all bits with fmix(), offset so 0 is not 0. */
+unsigned long hash_ulong(unsigned long k)
+{
+    return fmix(k + MIX_K1);
+}
+
+
+/* Return the hash function called 'name', or NULL if there is none. */
+hash_fn find_hash_fn(const char *name)
+{
+    if (!strcmp(name, "bytesum")) {
+        return hash_bytesum;
+    }
+    if (!strcmp(name, "fnv1a")) {
+        return hash_fnv1a;
+    }
+    if (!strcmp(name, "words")) {
+        return hash_words;
+    }
+    if (!strcmp(name, "lanes")) {
+        return hash_lanes;
+    }
+    return NULL;
+}
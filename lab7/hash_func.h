@@ -0,0 +1,73 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_func.h
+ *
+ *       Declaration of the string hash functions used by the hash
+ *       table engines.
+ *
+ */
+
+#ifndef HASH_FUNC_H
+#define HASH_FUNC_H
+
+#include <stddef.h>
+#include <limits.h>
+
+/*
+ * Every hash function takes a pointer to the first byte of a string
+ * and its length, so that the string need not be zero terminated.
+ */
+
+typedef unsigned long (*hash_fn)(const char *s, size_t len);
+
+/* Sum of the character codes; the original lab 7 hash.  Report only. */
+unsigned long hash_bytesum(const char *s, size_t len);
+
+/* FNV1a: one multiply per byte, small and portable. */
+unsigned long hash_fnv1a(const char *s, size_t len);
+
+/*
+ * Multiply/rotate mixing over whole machine words with a strong
+ * final avalanche, in the spirit of xxHash and wyhash.
+ */
+unsigned long hash_words(const char *s, size_t len);
+
+/*
+ * Like hash_words, but long strings are consumed by four independent
+ * accumulators, which the compiler can overlap or vectorize.  Short
+ * strings hash exactly as with hash_words.
+ */
+unsigned long hash_lanes(const char *s, size_t len);
+
+/*
+ * Hash an integer key.  Every bit of the key affects every bit of the
+ * result, so keys that differ only in their high bits still spread
+ * over a table indexed by the low bits.
+ */
+unsigned long hash_ulong(unsigned long k);
+
+/* Return the hash function called 'name', or NULL if there is none. */
+hash_fn find_hash_fn(const char *name);
+
+/*
+ * The function the hash table engines use.  Pick another one at build
+ * time with e.g. make HASH=hash_fnv1a.
+ */
+#ifndef HASH_FUNC
+#define HASH_FUNC hash_words
+#endif
+
+#define hash_string(s, len) HASH_FUNC((s), (len))
+
+/*
+ * Split keys into 'n' shards by the top 16 bits of their hash.  The
+ * tables take slot indices from the low bits, so the keys of one shard
+ * still spread over all the slots of a table.
+ */
+#define HASH_SHARD_BITS 16
+#define hash_shard(h, n) \
+    ((int) (((h) >> (sizeof(unsigned long) * CHAR_BIT - HASH_SHARD_BITS)) \
+            % (unsigned long) (n)))
+
+#endif  /* HASH_FUNC_H */
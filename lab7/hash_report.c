@@ -0,0 +1,262 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_report.c
+ *
+ *       Report how evenly each hash function in hash_func.c spreads
+ *       the distinct words of one or more input files over a table.
+ *
+ *       For every function and table size the report gives the share
+ *       of empty buckets, the longest chain, the average number of
+ *       keys examined by a successful lookup, and the ratio of that
+ *       average to the one expected from a uniformly random hash (1.00
+ *       is ideal, larger is worse).  It also counts distinct words
+ *       whose full hashes collide and times the function.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "hash_func.h"
+#include "memcheck.h"
+
+/* The bucket count of the original fixed-size table. */
+#define ORIGINAL_NSLOTS 128
+
+
+char *read_file(char *filename, size_t *size);
+char **split_words(char *buf, size_t size, size_t *nwords);
+size_t unique_words(char **words, size_t nwords);
+int compare_words(const void *a, const void *b);
+int compare_hashes(const void *a, const void *b);
+void report(char **words, size_t nwords, size_t *lens, char *name,
+            hash_fn fn, unsigned long nslots);
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s filename [filename...]\n", progname);
+}
+
+
+/* Read a whole file into a single zero-terminated buffer. */
+char *read_file(char *filename, size_t *size)
+{
+    FILE *f;
+    char *buf;
+    long n;
+
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Input file \"%s\" does not exist! "
+                "Terminating program.\n", filename);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf = (char *) malloc((size_t) n + 1);
+    if (buf == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    *size = fread(buf, 1, (size_t) n, f);
+    buf[*size] = '\0';
+    fclose(f);
+    return buf;
+}
+
+
+/*
+ * Cut the buffer into words in place by zeroing the whitespace, and
+ * return an array of pointers to them.
+ */
+char **split_words(char *buf, size_t size, size_t *nwords)
+{
+    char **words;
+    size_t i, n;
+
+    /* There can be no more words than half the bytes, rounded up. */
+    words = (char **) malloc((size / 2 + 1) * sizeof(char *));
+    if (words == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    n = 0;
+    for (i = 0; i < size; i++) {
+        if (isspace((unsigned char) buf[i])) {
+            buf[i] = '\0';
+        }
+        else if (i == 0 || buf[i - 1] == '\0') {
+            words[n++] = &buf[i];
+        }
+    }
+    *nwords = n;
+    return words;
+}
+
+
+int compare_words(const void *a, const void *b)
+{
+    return strcmp(*(char **) a, *(char **) b);
+}
+
+
+int compare_hashes(const void *a, const void *b)
+{
+    unsigned long x = *(unsigned long *) a;
+    unsigned long y = *(unsigned long *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* Sort the words and drop duplicates.  Return the new word count. */
+size_t unique_words(char **words, size_t nwords)
+{
+    size_t i, n;
+
+    if (nwords == 0) {
+        return 0;
+    }
+    qsort(words, nwords, sizeof(char *), compare_words);
+    n = 1;
+    for (i = 1; i < nwords; i++) {
+        if (strcmp(words[i], words[n - 1])) {
+            words[n++] = words[i];
+        }
+    }
+    return n;
+}
+
+
+/* Print one line of the report. */
+void report(char **words, size_t nwords, size_t *lens, char *name,
+            hash_fn fn, unsigned long nslots)
+{
+    unsigned long *hashes, *counts;
+    unsigned long empty, longest, collisions;
+    double probes, expected, seconds;
+    clock_t start;
+    size_t i;
+
+    hashes = (unsigned long *) malloc(nwords * sizeof(unsigned long));
+    counts = (unsigned long *) calloc(nslots, sizeof(unsigned long));
+    if (hashes == NULL || counts == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    start = clock();
+    for (i = 0; i < nwords; i++) {
+        hashes[i] = fn(words[i], lens[i]);
+    }
+    seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < nwords; i++) {
+        counts[hashes[i] % nslots]++;
+    }
+
+    empty = longest = 0;
+    probes = 0.0;
+    for (i = 0; i < nslots; i++) {
+        if (counts[i] == 0) {
+            empty++;
+        }
+        if (counts[i] > longest) {
+            longest = counts[i];
+        }
+        probes += (double) counts[i] * (counts[i] + 1) / 2.0;
+    }
+    probes /= (double) nwords;
+    expected = 1.0 + (double) (nwords - 1) / (2.0 * nslots);
+
+    qsort(hashes, nwords, sizeof(unsigned long), compare_hashes);
+    collisions = 0;
+    for (i = 1; i < nwords; i++) {
+        if (hashes[i] == hashes[i - 1]) {
+            collisions++;
+        }
+    }
+
+    printf("%-8s %9lu %6.1f%% %8lu %8.2f %7.2f %10lu %8.1f\n",
+           name, nslots, 100.0 * empty / nslots, longest, probes,
+           probes / expected, collisions, 1e9 * seconds / nwords);
+
+    free(hashes);
+    free(counts);
+}
+
+
+int main(int argc, char **argv)
+{
+    static char *names[] = { "bytesum", "fnv1a", "words", "lanes" };
+    char *buf;
+    char **words;
+    size_t *lens;
+    size_t size, nwords, i;
+    unsigned long nslots;
+    int arg, f;
+
+    if (argc < 2) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    for (arg = 1; arg < argc; arg++) {
+        buf = read_file(argv[arg], &size);
+        words = split_words(buf, size, &nwords);
+        nwords = unique_words(words, nwords);
+        if (nwords == 0) {
+            printf("%s: no words\n\n", argv[arg]);
+            free(words);
+            free(buf);
+            continue;
+        }
+
+        lens = (size_t *) malloc(nwords * sizeof(size_t));
+        if (lens == NULL) {
+            fprintf(stderr, "Error: memory allocation failed! "
+                    "Terminating program.\n");
+            exit(1);
+        }
+        for (i = 0; i < nwords; i++) {
+            lens[i] = strlen(words[i]);
+        }
+
+        /* Compare at the old size and at a load factor of about one. */
+        nslots = 1;
+        while (nslots < nwords) {
+            nslots *= 2;
+        }
+
+        printf("%s: %lu distinct words\n", argv[arg],
+               (unsigned long) nwords);
+        printf("%-8s %9s %7s %8s %8s %7s %10s %8s\n", "hash", "buckets",
+               "empty", "longest", "probes", "ratio", "collide", "ns/key");
+        for (f = 0; f < 4; f++) {
+            report(words, nwords, lens, names[f], find_hash_fn(names[f]),
+                   ORIGINAL_NSLOTS);
+        }
+        for (f = 0; f < 4; f++) {
+            report(words, nwords, lens, names[f], find_hash_fn(names[f]),
+                   nslots);
+        }
+        printf("\n");
+
+        free(lens);
+        free(words);
+        free(buf);
+    }
+
+    print_memory_leaks();
+    return 0;
+}
@@ -3,7 +3,9 @@
  *
  * FILE: hash_table.c
  *
- *       Implementation of the hash table functionality.
+ *       Implementation of the hash table functionality using
+ *       separate chaining.  See oa_hash_table.c for an open addressing
+ *       engine with the same interface.
  *
  */
 
@@ -18,56 +20,211 @@
 #include <stdlib.h>
 #include <string.h>
 #include "hash_table.h"
+#include "hash_func.h"
+#include "arena.h"
+#include "bloom_filter.h"
 #include "memcheck.h"
 
+/* Number of slots in a table created without a capacity hint. */
+#define INITIAL_SLOTS 128
 
-/*** Hash function. ***/
+/* Smallest table create_hash_table_sized() will build. */
+#define MIN_SLOTS 8
 
-int hash(char *s)
+/*
+ * Number of old buckets moved into the new array by each insertion
+ * while the table is growing.  The old array holds at most as many
+ * nodes as the new one has slots, so it is always drained long before
+ * the new array reaches its own growth threshold.
+ */
+#define REHASH_STEP 4
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * Declaration of the linked list `node' struct.  The key's hash and
+ * length are cached so that rehashing never reads the key, and most
+ * mismatches are rejected without comparing strings.
+ */
+
+typedef struct _node
+{
+    char *key;
+    unsigned long hash;
+    unsigned int len;   /* strlen(key) */
+    int value;
+    struct _node *next; /* pointer to the next node in the list */
+} node;
+
+/*
+ * Declaration of the hash table struct.
+ * 'slot' is an array of node pointers, so it's a pointer to a pointer.
+ *
+ * When the number of nodes exceeds the number of slots, a bucket array
+ * twice as large is allocated and the old one is kept in 'old_slot'.
+ * Each later insertion moves a few of the old buckets across, so the
+ * cost of growing is spread out instead of stalling a single call.
+ *
+ * Nodes and the copies of their keys are carved out of the table's
+ * arena, so freeing the table releases a few large chunks instead of
+ * walking every chain.  Nodes of removed keys are kept on a free list
+ * for reuse.
+ */
+
+struct _hash_table
 {
-    int i, len, count;
+    node **slot;
+    unsigned long nslots;       /* always a power of two */
+    node **old_slot;            /* array being drained, or NULL */
+    unsigned long old_nslots;
+    unsigned long rehash_pos;   /* next old bucket to move across */
+    unsigned long count;        /* number of keys in the table */
+    arena store;                /* nodes and key strings */
+    node *free_nodes;           /* removed nodes, linked through 'next' */
+    bloom_filter *filter;       /* see hash_table_use_filter(), or NULL */
+};
+
+
+/*
+ * Function prototypes for the chaining engine's private utilities.
+ */
+
+/* Create a single node whose 'next' field is NULL. */
+node *create_node(hash_table *ht, const char *key, size_t len,
+                  unsigned long h, int value);
+
+node **alloc_slots(unsigned long nslots);
+void start_growing(hash_table *ht);
+void rehash_step(hash_table *ht, unsigned long nbuckets);
+node **find_link(hash_table *ht, const char *key, size_t len,
+                 unsigned long h);
+void add_chain_length(hash_stats *stats, node *link_list);
+void filter_insert(hash_table *ht, unsigned long h);
+void refill_filter(hash_table *ht);
+
+
+/*** Linked list utilities. ***/
+
+/*
+ * Create a single node in the table's arena, reusing the node of a
+ * removed key if there is one.  The 'len' bytes of 'key' (whose hash
+ * is 'h') are copied into the arena as well.
+ */
+node *create_node(hash_table *ht, const char *key, size_t len,
+                  unsigned long h, int value) {
+    node *result;
 
-    count = 0;
-    len = strlen(s);
-    for (i = 0; i < len; i++) {
-        count += (int) (s[i]);
+    if (ht->free_nodes != NULL) {
+        result = ht->free_nodes;
+        ht->free_nodes = result->next;
+    }
+    else {
+        result = (node *)arena_alloc(&ht->store, sizeof(node));
     }
-    count %= NSLOTS;
-    return count;
+
+    /* Fill in the new node with the given value. */
+    result->key = arena_strdup(&ht->store, key, len);
+    result->hash = h;
+    result->len = (unsigned int) len;
+    result->value = value;
+    result->next = NULL;
+
+    return result;
 }
 
 
-/*** Linked list utilities. ***/
+/*** Bucket array utilities. ***/
 
-/* Create a single node. */
-node *create_node(char *key, int value) {
-    node *result = (node *)malloc(sizeof(node));
+/* Allocate an array of 'nslots' empty buckets. */
+node **alloc_slots(unsigned long nslots)
+{
+    node **arr = (node **) calloc(nslots, sizeof(node *));
 
-    if (result == NULL) {
+    if (arr == NULL) {
         fprintf(stderr, "Fatal error: out of memory. "
                 "Terminating program.\n");
         exit(1);
     }
+    return arr;
+}
 
-    result->key = key;  /* Fill in the new node with the given value. */
-    result->value = value;
-    result->next = NULL;
 
-    return result;
+/*
+ * Make the current bucket array the old one and replace it with an
+ * empty array twice as large.  The buckets are moved across later, a
+ * few at a time, by rehash_step().
+ */
+void start_growing(hash_table *ht)
+{
+    ht->old_slot = ht->slot;
+    ht->old_nslots = ht->nslots;
+    ht->rehash_pos = 0;
+    ht->nslots *= 2;
+    ht->slot = alloc_slots(ht->nslots);
+}
+
+
+/*
+ * Move up to 'nbuckets' buckets of the old array into the current
+ * one, and release the old array once it has been drained.
+ */
+void rehash_step(hash_table *ht, unsigned long nbuckets)
+{
+    node *link_list, *next;
+    unsigned long hash_val;
+
+    while (ht->old_slot != NULL && nbuckets-- > 0) {
+        link_list = ht->old_slot[ht->rehash_pos];
+        ht->old_slot[ht->rehash_pos] = NULL;
+        while (link_list != NULL) {
+            next = link_list->next;
+            hash_val = link_list->hash & (ht->nslots - 1);
+            link_list->next = ht->slot[hash_val];
+            ht->slot[hash_val] = link_list;
+            link_list = next;
+        }
+
+        if (++ht->rehash_pos == ht->old_nslots) {
+            free(ht->old_slot);
+            ht->old_slot = NULL;
+        }
+    }
 }
 
 
+/* Whether node 'n' holds the 'len' bytes at 'key', whose hash is 'h'. */
+#define NODE_MATCHES(n, key, len, h) \
+    ((n)->hash == (h) && (n)->len == (len) && !memcmp((n)->key, (key), (len)))
 
-/* Free all the nodes of a linked list. */
-void free_list(node *list) {
-    node *n;     /* a single node of the list */
+/*
+ * Return the link that points at the node holding the 'len' bytes at
+ * 'key' (whose hash is 'h'), or a link that points at NULL if the key
+ * is not in the table.  Buckets of the old array that have not been
+ * moved yet are searched first.
+ */
+node **find_link(hash_table *ht, const char *key, size_t len,
+                 unsigned long h)
+{
+    node **link;
+
+    if (ht->old_slot != NULL) {
+        link = &ht->old_slot[h & (ht->old_nslots - 1)];
+        while (*link != NULL) {
+            if (NODE_MATCHES(*link, key, len, h)) {
+                return link;
+            }
+            link = &(*link)->next;
+        }
+    }
 
-    while (list != NULL) {
-        n = list;
-        list = list->next;
-        free(n->key);
-        free(n);
+    link = &ht->slot[h & (ht->nslots - 1)];
+    while (*link != NULL && !NODE_MATCHES(*link, key, len, h)) {
+        link = &(*link)->next;
     }
+    return link;
 }
 
 
@@ -76,36 +233,55 @@ void free_list(node *list) {
 /* Create a new hash table. */
 hash_table *create_hash_table()
 {
-    int i;
-    node **arr;
+    return create_hash_table_sized(INITIAL_SLOTS);
+}
+
+
+/*
+ * Create a hash table sized for about 'capacity_hint' keys, so that
+ * tables whose final size is known up front never have to grow.
+ */
+hash_table *create_hash_table_sized(unsigned long capacity_hint)
+{
     hash_table *ht;
 
     ht = (hash_table *) malloc(sizeof(hash_table));
-    arr = (node **) calloc(NSLOTS, sizeof(node *));
-    if ((ht == NULL) || (arr == NULL)) {
+    if (ht == NULL) {
         fprintf(stderr, "Fatal error: out of memory. "
                 "Terminating program.\n");
         exit(1);
     }
 
-
-    for (i = 0; i < NSLOTS; i++) {
-        arr[i] = NULL;
+    ht->nslots = MIN_SLOTS;
+    while (ht->nslots < capacity_hint) {
+        ht->nslots *= 2;
     }
-    ht->slot = arr;
+    ht->slot = alloc_slots(ht->nslots);
+    ht->old_slot = NULL;
+    ht->old_nslots = 0;
+    ht->rehash_pos = 0;
+    ht->count = 0;
+    arena_init(&ht->store);
+    ht->free_nodes = NULL;
+    ht->filter = NULL;
     return ht;
 }
 
 
-/* Free a hash table. */
+/*
+ * Free a hash table.  All the nodes and keys live in the arena, so the
+ * chains never have to be walked.
+ */
 void free_hash_table(hash_table *ht)
 {
-    int i;
-
-    for (i = 0; i < NSLOTS; i++) {
-        free_list(ht->slot[i]);
+    if (ht->old_slot != NULL) {
+        free(ht->old_slot);
     }
     free(ht->slot);
+    arena_free(&ht->store);
+    if (ht->filter != NULL) {
+        free_bloom_filter(ht->filter);
+    }
     free(ht);
 }
 
@@ -116,64 +292,404 @@ void free_hash_table(hash_table *ht)
  */
 int get_value(hash_table *ht, char *key)
 {
-    int hash_val;
-    node *link_list;
+    size_t len = strlen(key);
+    unsigned long h = hash_string(key, len);
+    node *n;
 
-    hash_val = hash(key);
-    link_list = ht->slot[hash_val];
-    while (link_list != NULL) {
-        if (!strcmp(link_list->key, key)) {
-            return link_list->value;
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    n = *find_link(ht, key, len, h);
+    if (n == NULL) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
         }
-        link_list = link_list->next;
+        return 0;
     }
-    return 0;
+    return n->value;
 }
 
 
 /*
  * Set the value stored at a key.  If the key is not in the table,
  * create a new node and set the value to 'value'.  Note that this
- * function alters the hash table that was passed to it.
+ * function alters the hash table that was passed to it.  The table
+ * stores its own copy of 'key'.
  */
 void set_value(hash_table *ht, char *key, int value) {
-    int hash_val;
-    node *link_list;
+    unsigned long h;
+    size_t len;
+    node **link;
+
+    rehash_step(ht, REHASH_STEP);
 
-    hash_val = hash(key);
     /* The 1st case handles if the key already exists in the hash table */
-    if (get_value(ht, key)) {
-        link_list = ht->slot[hash_val];
-        while (link_list != NULL) {
-            /* strcomp returns 0 if the string are the same */
-            if (!strcmp(link_list->key, key)) {
-                link_list->value = value;
-                free(key);
-                return;
+    len = strlen(key);
+    h = hash_string(key, len);
+    link = find_link(ht, key, len, h);
+    if (*link != NULL) {
+        (*link)->value = value;
+        return;
+    }
+
+    /* The 2nd case appends a new node to the chain that was searched. */
+    *link = create_node(ht, key, len, h, value);
+    ht->count++;
+    filter_insert(ht, h);
+
+    /* Start growing once the average chain is longer than one node. */
+    if (ht->count > ht->nslots && ht->old_slot == NULL) {
+        start_growing(ht);
+    }
+}
+
+
+/*
+ * Return a pointer to the value stored at a key, inserting the key
+ * with a value of 0 if it is not in the table yet.  The key is looked
+ * up once and copied only if it is new.  The pointer is valid until
+ * the table is next modified.
+ */
+int *find_or_insert(hash_table *ht, char *key)
+{
+    return find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as find_or_insert, for a key given as 'len' bytes that need
+ * not be zero terminated.
+ */
+int *find_or_insert_n(hash_table *ht, const char *key, size_t len)
+{
+    return find_or_insert_hashed(ht, key, len, hash_string(key, len));
+}
+
+
+/*
+ * The same as find_or_insert_n, for a key whose hash_string() value
+ * 'h' the caller has already computed.
+ */
+int *find_or_insert_hashed(hash_table *ht, const char *key, size_t len,
+                           unsigned long h)
+{
+    node **link;
+    node *n;
+
+    rehash_step(ht, REHASH_STEP);
+
+    link = find_link(ht, key, len, h);
+    n = *link;
+    if (n == NULL) {
+        n = create_node(ht, key, len, h, 0);
+        *link = n;
+        ht->count++;
+        filter_insert(ht, h);
+        if (ht->count > ht->nslots && ht->old_slot == NULL) {
+            start_growing(ht);
+        }
+    }
+    return &n->value;
+}
+
+
+/*
+ * Add one to the value stored at a key, inserting the key with a value
+ * of 1 if it is not in the table yet.  Return the new value.
+ */
+int increment(hash_table *ht, char *key)
+{
+    return ++*find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as increment, for a key given as 'len' bytes that need not
+ * be zero terminated.
+ */
+int increment_n(hash_table *ht, const char *key, size_t len)
+{
+    return ++*find_or_insert_n(ht, key, len);
+}
+
+
+/*
+ * Remove a key from the hash table.  Return 1 if the key was found and
+ * removed, otherwise 0.  The node is kept for reuse; the copy of the
+ * key is reclaimed only when the table is freed.
+ */
+int remove_key(hash_table *ht, char *key)
+{
+    unsigned long h;
+    size_t len;
+    node **link;
+    node *n;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    link = find_link(ht, key, len, h);
+    n = *link;
+    if (n == NULL) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
+        }
+        return 0;
+    }
+
+    *link = n->next;
+    n->next = ht->free_nodes;
+    ht->free_nodes = n;
+    ht->count--;
+    return 1;
+}
+
+
+/*
+ * Add the value of every key of 'src' to the value of the same key in
+ * 'dst', inserting keys that 'dst' does not have yet.  'src' is not
+ * changed.  The cached hashes are reused, so no key is hashed again.
+ */
+void merge_hash_tables(hash_table *dst, hash_table *src)
+{
+    unsigned long i;
+    node *n;
+
+    if (src->old_slot != NULL) {
+        for (i = src->rehash_pos; i < src->old_nslots; i++) {
+            for (n = src->old_slot[i]; n != NULL; n = n->next) {
+                *find_or_insert_hashed(dst, n->key, n->len, n->hash) +=
+                    n->value;
             }
-            link_list = link_list->next;
         }
     }
-    /* The 2nd case creates a new node if the key doesn't exist in ht yet */
-    else {
-        link_list = create_node(key, value);
-        link_list->next = ht->slot[hash_val];
-        ht->slot[hash_val] = link_list;
+    for (i = 0; i < src->nslots; i++) {
+        for (n = src->slot[i]; n != NULL; n = n->next) {
+            *find_or_insert_hashed(dst, n->key, n->len, n->hash) += n->value;
+        }
+    }
+}
+
+
+/* Offer every key of the hash table and its value to a top K heap. */
+void top_k_hash_table(hash_table *ht, top_k *heap)
+{
+    unsigned long i;
+    node *link_list;
+
+    if (ht->old_slot != NULL) {
+        for (i = ht->rehash_pos; i < ht->old_nslots; i++) {
+            for (link_list = ht->old_slot[i]; link_list != NULL;
+                 link_list = link_list->next) {
+                top_k_offer(heap, link_list->key, link_list->value);
+            }
+        }
+    }
+    for (i = 0; i < ht->nslots; i++) {
+        for (link_list = ht->slot[i]; link_list != NULL;
+             link_list = link_list->next) {
+            top_k_offer(heap, link_list->key, link_list->value);
+        }
+    }
+}
+
+
+/* Return the number of keys in the hash table. */
+unsigned long hash_table_size(hash_table *ht)
+{
+    return ht->count;
+}
+
+
+/* Store every key and its value in 'out'. */
+unsigned long collect_hash_table(hash_table *ht, word_count *out)
+{
+    unsigned long i, n;
+    node *link_list;
+
+    n = 0;
+    if (ht->old_slot != NULL) {
+        for (i = ht->rehash_pos; i < ht->old_nslots; i++) {
+            for (link_list = ht->old_slot[i]; link_list != NULL;
+                 link_list = link_list->next) {
+                out[n].key = link_list->key;
+                out[n++].value = link_list->value;
+            }
+        }
+    }
+    for (i = 0; i < ht->nslots; i++) {
+        for (link_list = ht->slot[i]; link_list != NULL;
+             link_list = link_list->next) {
+            out[n].key = link_list->key;
+            out[n++].value = link_list->value;
+        }
     }
+    return n;
 }
 
 
 /* Print out the contents of the hash table as key/value pairs. */
 void print_hash_table(hash_table *ht)
 {
-    int i;
+    unsigned long i;
     node *link_list;
 
-    for (i = 0; i < NSLOTS; i++) {
+    if (ht->old_slot != NULL) {
+        for (i = ht->rehash_pos; i < ht->old_nslots; i++) {
+            for (link_list = ht->old_slot[i]; link_list != NULL;
+                 link_list = link_list->next) {
+                printf("%s %d\n", link_list->key, link_list->value);
+            }
+        }
+    }
+    for (i = 0; i < ht->nslots; i++) {
         link_list = ht->slot[i];
         while (link_list != NULL) {
             printf("%s %d\n", link_list->key, link_list->value);
             link_list = link_list->next;
         }
     }
-}
\ No newline at end of file
+}
+
+
+/*** Iteration and statistics. ***/
+
+/*
+ * The cursor's 'pos' counts the buckets already taken: those of the
+ * old array from 'rehash_pos' on, then those of the current one.  Its
+ * 'link' is the next node of the bucket it is in, or NULL.
+ */
+void hash_table_begin(hash_table_cursor *c)
+{
+    c->pos = 0;
+    c->link = NULL;
+}
+
+
+int hash_table_next(hash_table *ht, hash_table_cursor *c,
+                    const char **key, int **value)
+{
+    unsigned long nold;
+    node *n;
+
+    nold = (ht->old_slot != NULL) ? ht->old_nslots - ht->rehash_pos : 0;
+    n = (node *) c->link;
+    while (n == NULL) {
+        if (c->pos < nold) {
+            n = ht->old_slot[ht->rehash_pos + c->pos];
+        }
+        else if (c->pos < nold + ht->nslots) {
+            n = ht->slot[c->pos - nold];
+        }
+        else {
+            return 0;
+        }
+        c->pos++;
+    }
+
+    c->link = n->next;
+    *key = n->key;
+    *value = &n->value;
+    return 1;
+}
+
+
+/* Add the length of the chain 'link_list' to the histogram. */
+void add_chain_length(hash_stats *stats, node *link_list)
+{
+    unsigned long len;
+
+    len = 0;
+    for (; link_list != NULL; link_list = link_list->next) {
+        len++;
+    }
+    stats->histogram[len < HASH_STATS_LENGTHS ? len
+                                              : HASH_STATS_LENGTHS - 1]++;
+    if (len > stats->max_length) {
+        stats->max_length = len;
+    }
+}
+
+
+void hash_table_stats(hash_table *ht, hash_stats *stats)
+{
+    unsigned long i;
+
+    memset(stats, 0, sizeof(hash_stats));
+    stats->keys = ht->count;
+    stats->slots = ht->nslots;
+    if (ht->old_slot != NULL) {
+        stats->slots += ht->old_nslots - ht->rehash_pos;
+        for (i = ht->rehash_pos; i < ht->old_nslots; i++) {
+            add_chain_length(stats, ht->old_slot[i]);
+        }
+    }
+    for (i = 0; i < ht->nslots; i++) {
+        add_chain_length(stats, ht->slot[i]);
+    }
+
+    stats->load_factor = (double) stats->keys / stats->slots;
+    if (stats->slots > stats->histogram[0]) {
+        stats->mean_length = (double) stats->keys /
+                             (stats->slots - stats->histogram[0]);
+    }
+    if (ht->filter != NULL) {
+        stats->filter_checks = ht->filter->checks;
+        stats->filter_rejects = ht->filter->rejects;
+        stats->filter_false_positives = ht->filter->false_positives;
+    }
+}
+
+
+/*** Negative lookup filter. ***/
+
+/*
+ * Add a new key's hash to the filter, if the table has one.  Once the
+ * keys outgrow the filter it is rebuilt twice as large, which also
+ * drops the keys removed since it was last built.
+ */
+void filter_insert(hash_table *ht, unsigned long h)
+{
+    if (ht->filter == NULL) {
+        return;
+    }
+    if (ht->count <= ht->filter->capacity) {
+        bloom_add(ht->filter, h);
+    }
+    else {
+        clear_bloom_filter(ht->filter, 2 * ht->filter->capacity);
+        refill_filter(ht);
+    }
+}
+
+
+/* Add every key of the table to its filter, from the cached hashes. */
+void refill_filter(hash_table *ht)
+{
+    unsigned long i;
+    node *n;
+
+    if (ht->old_slot != NULL) {
+        for (i = ht->rehash_pos; i < ht->old_nslots; i++) {
+            for (n = ht->old_slot[i]; n != NULL; n = n->next) {
+                bloom_add(ht->filter, n->hash);
+            }
+        }
+    }
+    for (i = 0; i < ht->nslots; i++) {
+        for (n = ht->slot[i]; n != NULL; n = n->next) {
+            bloom_add(ht->filter, n->hash);
+        }
+    }
+}
+
+
+void hash_table_use_filter(hash_table *ht)
+{
+    if (ht->filter == NULL) {
+        ht->filter = create_bloom_filter(2 * ht->count + INITIAL_SLOTS);
+        refill_filter(ht);
+    }
+}
@@ -15,57 +15,88 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
-/* Number of slots in the hash table array. */
-#define NSLOTS 128
+#include <stddef.h>
+#include "top_k.h"
 
 /*
  * Data structure definitions.
  */
 
 /*
- * Declaration of the linked list `node' struct.
+ * Declaration of the hash table struct.  The layout depends on which
+ * engine the program is linked with (hash_table.c uses separate
+ * chaining, oa_hash_table.c uses open addressing and swiss_hash_table.c
+ * probes groups of slots), so the struct is only defined inside the
+ * engine's own source file.
  */
 
-typedef struct _node
-{
-    char *key;
-    int value;
-    struct _node *next; /* pointer to the next node in the list */
-} node;
+typedef struct _hash_table hash_table;
 
 /*
- * Declaration of the hash table struct.
- * 'slot' is an array of node pointers, so it's a pointer to a pointer.
+ * A position in an iteration over a table (see hash_table_next).  The
+ * fields belong to the engine.
  */
 
 typedef struct
 {
-    node **slot;
-} hash_table;
-
+    unsigned long pos;
+    void *link;
+} hash_table_cursor;
 
 /*
- * Function declarations.
+ * Occupancy of a table (see hash_table_stats).  What a "length" is
+ * depends on the engine:
+ *
+ *     hash_table.c:        the length of each bucket's chain, empty
+ *                          buckets included.
+ *     oa_hash_table.c:     the number of slots a lookup of each key
+ *                          reads, from 1 for a key in its home slot.
+ *     swiss_hash_table.c:  the number of groups of 16 slots a lookup of
+ *                          each key reads, from 1.
+ *
+ * histogram[i] counts the lengths equal to i, and the last entry also
+ * counts every longer one.  The mean is over nonzero lengths.  While a
+ * table grows incrementally the slots of the array being drained are
+ * counted too.
+ *
+ * For a table with a filter (see hash_table_use_filter) the last three
+ * fields count the lookups checked against it, those it answered on
+ * its own, and those it let through for keys that were not there.
+ * The observed false positive rate is the last over the last two.
  */
 
-/*** Hash function. ***/
-
-int hash(char *s);
+#define HASH_STATS_LENGTHS 16
 
+typedef struct
+{
+    unsigned long keys;
+    unsigned long slots;            /* buckets or slots */
+    double load_factor;             /* keys / slots */
+    unsigned long max_length;
+    double mean_length;
+    unsigned long histogram[HASH_STATS_LENGTHS];
+    unsigned long filter_checks;
+    unsigned long filter_rejects;
+    unsigned long filter_false_positives;
+} hash_stats;
 
-/*** Linked list utilities. ***/
-
-/* Create a single node whose 'next' field is NULL. */
-node *create_node(char *key, int value);
-
-/* Free all the nodes of a linked list. */
-void free_list(node *list);
 
+/*
+ * Function declarations.
+ */
 
 /*** Hash table utilities. ***/
 
+/* Create a new, empty hash table. */
 hash_table *create_hash_table(void);
 
+/*
+ * Create a hash table sized for about 'capacity_hint' keys.  Every
+ * table grows on demand; the hint only saves the early growth steps
+ * when the final size is known up front.
+ */
+hash_table *create_hash_table_sized(unsigned long capacity_hint);
+
 void free_hash_table(hash_table *ht);
 
 /*
@@ -76,14 +107,111 @@ int get_value(hash_table *ht, char *key);
 
 /*
  * Set the value stored at a key.  If the key is not in the table,
- * create a new node and set the value to 'value'.  Note that this
- * function alters the hash table that was passed to it.
+ * create a new entry and set the value to 'value'.  Note that this
+ * function alters the hash table that was passed to it.  The table
+ * stores its own copy of 'key', so the caller keeps ownership of it.
  */
 void set_value(hash_table *ht, char *key, int value);
 
+/*
+ * Return a pointer to the value stored at a key, inserting the key
+ * with a value of 0 if it is not in the table yet.  Unlike calling
+ * get_value and then set_value, this looks the key up only once.  A
+ * new key is copied as with set_value.  The pointer is valid until the
+ * table is next modified.
+ */
+int *find_or_insert(hash_table *ht, char *key);
+
+/*
+ * The same as find_or_insert, for a key given as the 'len' bytes at
+ * 'key', which need not be zero terminated.  This lets a tokenizer
+ * count words in place without copying them first.
+ */
+int *find_or_insert_n(hash_table *ht, const char *key, size_t len);
+
+/*
+ * The same as find_or_insert_n, for callers that have already hashed
+ * the key with hash_string() (from hash_func.h), e.g. to pick a shard.
+ */
+int *find_or_insert_hashed(hash_table *ht, const char *key, size_t len,
+                           unsigned long h);
+
+/*
+ * Add one to the value stored at a key, inserting the key with a value
+ * of 1 if it is not in the table yet.  Return the new value.
+ */
+int increment(hash_table *ht, char *key);
+
+/* The same as increment, for a key given as 'len' bytes. */
+int increment_n(hash_table *ht, const char *key, size_t len);
+
+/*
+ * Remove a key from the hash table.  Return 1 if the key was found and
+ * removed, otherwise 0.
+ */
+int remove_key(hash_table *ht, char *key);
+
+/*
+ * Add the value of every key of 'src' to the value of the same key in
+ * 'dst', inserting keys that 'dst' does not have yet.  'src' is not
+ * changed.
+ */
+void merge_hash_tables(hash_table *dst, hash_table *src);
+
+/*
+ * Offer every key of the hash table and its value to a top K heap (see
+ * top_k.h).  The keys offered belong to the table, so the heap must be
+ * finished with before the table is modified or freed.  Offering the
+ * shards of a split table one after another gives the top K overall.
+ */
+void top_k_hash_table(hash_table *ht, top_k *heap);
+
+/* Return the number of keys in the hash table. */
+unsigned long hash_table_size(hash_table *ht);
+
+/*
+ * Store every key of the hash table and its value in 'out', which must
+ * have room for hash_table_size(ht) entries, and return the number of
+ * entries stored.  As with top_k_hash_table, the keys belong to the
+ * table.  This gathers a table for sorting (see word_output.h).
+ */
+unsigned long collect_hash_table(hash_table *ht, word_count *out);
+
 /* Print out the contents of the hash table as key/value pairs. */
 void print_hash_table(hash_table *ht);
 
+/*** Iteration and statistics. ***/
+
+/*
+ * Set a cursor to the start of an iteration.  The cursor is not tied
+ * to a table until it is first passed to hash_table_next().
+ */
+void hash_table_begin(hash_table_cursor *c);
+
+/*
+ * Step a cursor to the next key of the table.  Return 1 and set 'key'
+ * and 'value' to the key and a pointer to its value, or return 0 once
+ * every key has been visited.  Keys come in no particular order.  The
+ * values may be changed through the pointers, but the cursor and the
+ * pointers are only valid until a key is next inserted or removed.
+ */
+int hash_table_next(hash_table *ht, hash_table_cursor *c,
+                    const char **key, int **value);
+
+/* Measure the occupancy of the table, for spotting a poor hash. */
+void hash_table_stats(hash_table *ht, hash_stats *stats);
+
+/*** Negative lookup filter. ***/
+
+/*
+ * Keep a blocked Bloom filter of the table's keys (see bloom_filter.h)
+ * in front of get_value() and remove_key(), for tables that are mostly
+ * asked about keys they do not have: the filter rules most of those
+ * out in one cache line, without probing the table.  Every insertion
+ * also adds to the filter.  Calling this again does nothing.
+ */
+void hash_table_use_filter(hash_table *ht);
+
 /* This line is part of the "include guard": */
 #endif  /* HASH_TABLE_H */
 
@@ -9,26 +9,101 @@
 
 /*
  * EXTRA CREDIT:
- *     The memory allocation can be optimized because right now there
- *     is a dynamic allocation that occurs even if the word already exists
- *     inside the hash table which later is freed in the set_value function
- *     but it is unused and useless. This can be optimized by checking on
- *     line 86 whether or not the statically defined word already exists
- *     in the hash table, and if it is, it skips the dynamic allocation.
+ *     Words are read straight out of the mapped input file and counted
+ *     with increment_n(), which looks each word up once and copies it
+ *     into the table's arena only when it is new.  The original path,
+ *     which calls get_value() and then set_value() and makes a dynamic
+ *     copy of every word even if it already exists in the hash table,
+ *     is still available with the -o option so that the two can be
+ *     compared (see run_bench).
+ *
+ *     With -j N the input is counted by N threads; see parallel_count.h.
+ *
+ *     With -k K only the K most common words are printed, found with a
+ *     bounded heap (top_k.h) instead of sorting the whole table.  With
+ *     -s M they are estimated in fixed memory by M Space Saving counters
+ *     (space_saving.h), without a hash table at all.
+ *
+ *     With -a or -n the words are printed sorted by key or by count with
+ *     radix sorts and large buffered writes (word_output.h), so that the
+ *     output needs no external sort.
+ *
+ *     With -w the counts are saved to a file (saved_table.h), and with
+ *     -l a saved count is added to the new one, so that a count can be
+ *     carried from run to run.  With -q the saved counts of the input
+ *     words are looked up in the mapped file without building a table.
+ *
+ *     With -z the final counts are frozen into a file for read only
+ *     lookups (frozen_table.h): a minimal perfect hash over the words
+ *     sends each one straight to its entry of a dense array, without
+ *     probing.  -q reads frozen tables as well as saved ones.
+ *
+ *     With -t the occupancy of each table is reported on stderr (see
+ *     hash_table_stats() in hash_table.h), to spot a poorly spread hash.
+ *
+ *     With -b the time spent reading, tokenizing, hashing and printing,
+ *     the words counted per second and the peak memory use are reported
+ *     on stderr.  run_bench uses it on corpora made by gen_corpus.
+ *
+ *     With -i words are counted without regard to case or to the
+ *     punctuation around them.  The tokenizer lower cases each word as
+ *     it copies it out of the input, so the input needs no separate
+ *     pass to normalize it first.
+ *
+ *     With -f the table keeps a Bloom filter in front of its lookups
+ *     (see hash_table_use_filter() in hash_table.h).  Only the -o path
+ *     looks words up before inserting them, and every first sight of a
+ *     word is such a miss; -t reports how many the filter caught.
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/resource.h>
 #include "hash_table.h"
+#include "tokenizer.h"
+#include "parallel_count.h"
+#include "space_saving.h"
+#include "word_output.h"
+#include "saved_table.h"
+#include "frozen_table.h"
 #include "memcheck.h"
 
-#define MAX_WORD_LENGTH 100
+/* Output orders. */
+#define UNSORTED      0
+#define SORT_BY_KEY   1
+#define SORT_BY_COUNT 2
 
 
 void usage(char *progname)
 {
-    fprintf(stderr, "usage: %s filename\n", progname);
+    fprintf(stderr, "usage: %s [-o | -j nthreads | -s ncounters] "
+            "[-k K | -a | -n]\n"
+            "       [-l saved] [-w saved] [-z frozen] [-t] [-b] [-i] [-f] "
+            "filename\n"
+            "       %s -q saved|frozen [-i] filename\n", progname, progname);
+    fprintf(stderr, "    -o: count with get_value() and set_value()\n");
+    fprintf(stderr, "    -j: count with 1 to %d threads\n", MAX_THREADS);
+    fprintf(stderr, "    -s: estimate the top K words with a fixed number "
+            "of counters\n");
+    fprintf(stderr, "    -k: print only the K most common words, most "
+            "common first\n");
+    fprintf(stderr, "    -a: print every word, sorted by key\n");
+    fprintf(stderr, "    -n: print every word, most common first\n");
+    fprintf(stderr, "    -l: add the counts of a saved table\n");
+    fprintf(stderr, "    -w: save the counts to a table file\n");
+    fprintf(stderr, "    -z: freeze the counts into a perfect hash "
+            "table file\n");
+    fprintf(stderr, "    -q: print the saved or frozen count of every "
+            "input word\n");
+    fprintf(stderr, "    -t: report the occupancy of each table\n");
+    fprintf(stderr, "    -b: report the time taken and the memory used\n");
+    fprintf(stderr, "    -i: ignore case and strip punctuation\n");
+    fprintf(stderr, "    -f: filter lookups of new words with a Bloom "
+            "filter\n");
 }
 
 void add_to_hash_table(hash_table *ht, char *key)
@@ -37,79 +112,512 @@ void add_to_hash_table(hash_table *ht, char *key)
     set_value(ht, key, v + 1);
 }
 
+/* Print the words kept by a top K heap, most common first. */
+void print_top_k(top_k *heap)
+{
+    size_t i, n;
+
+    n = top_k_finish(heap);
+    for (i = 0; i < n; i++)
+    {
+        printf("%s %d\n", heap->items[i].key, heap->items[i].value);
+    }
+}
+
+/* Map a saved table, or exit. */
+void open_saved_or_exit(saved_table *st, char *filename)
+{
+    if (open_saved_table(st, filename) != 0)
+    {
+        fprintf(stderr, "\"%s\" is not a saved table! "
+                        "Terminating program.\n", filename);
+        exit(1);
+    }
+}
+
+/* Wall clock time in seconds. */
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Time a pass that only finds the words of the input, through a copy
+ * of 'input' so that the input itself is not used up, and set 'nwords'
+ * to their number.
+ */
+double time_tokenizing(tokenizer *input, unsigned long *nwords)
+{
+    tokenizer pass;
+    const char *word;
+    size_t len;
+    double start;
+    double elapsed;
+
+    tokenizer_split(input, &pass, 1);
+    *nwords = 0;
+    start = now();
+    while (next_word(&pass, &word, &len))
+    {
+        (*nwords)++;
+    }
+    elapsed = now() - start;
+
+    tokenizer_close(&pass);
+    return elapsed;
+}
+
+/*
+ * Report on stderr where the time went and the peak memory use.  The
+ * time spent hashing is the counting time less the tokenizing time.
+ */
+void print_report(unsigned long nwords, size_t nbytes, double read_time,
+                  double tokenize_time, double count_time,
+                  double output_time)
+{
+    struct rusage usage;
+    double hash_time;
+
+    getrusage(RUSAGE_SELF, &usage);
+    hash_time = count_time - tokenize_time;
+    fprintf(stderr, "bench: %lu words, %lu bytes; read %.3f s, "
+            "tokenize %.3f s, hash %.3f s, output %.3f s; "
+            "%.0f words/s, peak RSS %ld kB\n", nwords,
+            (unsigned long)nbytes, read_time > 0 ? read_time : 0.0,
+            tokenize_time, hash_time > 0 ? hash_time : 0.0, output_time,
+            count_time > 0 ? nwords / count_time : 0.0,
+            (long)usage.ru_maxrss);
+}
+
+/* Report the occupancy of table number 'n' on stderr. */
+void print_stats(hash_table *ht, int n)
+{
+    hash_stats stats;
+    unsigned long misses;
+    int i;
+
+    hash_table_stats(ht, &stats);
+    fprintf(stderr, "table %d: %lu keys in %lu slots, load %.2f, "
+            "length mean %.2f max %lu\n", n, stats.keys, stats.slots,
+            stats.load_factor, stats.mean_length, stats.max_length);
+    for (i = 0; i < HASH_STATS_LENGTHS; i++)
+    {
+        if (stats.histogram[i] > 0)
+        {
+            fprintf(stderr, "    length %2d%s: %lu\n", i,
+                    i == HASH_STATS_LENGTHS - 1 ? "+" : " ",
+                    stats.histogram[i]);
+        }
+    }
+    if (stats.filter_checks > 0)
+    {
+        misses = stats.filter_rejects + stats.filter_false_positives;
+        fprintf(stderr, "    filter: %lu checks, %lu rejected, "
+                "%lu false positives (%.2f%% of misses)\n",
+                stats.filter_checks, stats.filter_rejects,
+                stats.filter_false_positives,
+                misses > 0 ? 100.0 * stats.filter_false_positives / misses
+                           : 0.0);
+    }
+}
+
+/* Print the words of 'ntables' tables in the given order. */
+void print_sorted(hash_table **tables, int ntables, int order)
+{
+    word_count *words;
+    unsigned long n;
+
+    words = gather_hash_tables(tables, ntables, &n);
+
+    /* The count sort is stable, so equal counts stay sorted by key. */
+    sort_by_key(words, n);
+    if (order == SORT_BY_COUNT)
+    {
+        sort_by_count(words, n);
+    }
+
+    write_word_counts(1, words, n);
+    free(words);
+}
+
 
 int main(int argc, char **argv)
 {
-    int   nwords;
-    FILE *input_file;
-    char  word[MAX_WORD_LENGTH];
-    char  line[MAX_WORD_LENGTH];
+    int   i;
+    int   old_path;
+    int   nthreads;
+    long  k;
+    long  ncounters;
+    int   order;
+    int   show_stats;
+    int   report;
+    int   normalize;
+    int   use_filter;
+    char *filename;
+    const char *word;
+    size_t len;
     char *new_word;
+    tokenizer input;
     hash_table *ht;
+    hash_table **tables;
+    int   ntables;
+    char *load_file;
+    char *save_file;
+    char *freeze_file;
+    char *query_file;
+    saved_table saved;
+    frozen_table frozen;
+    space_saving *ss;
+    word_count *items;
+    top_k heap;
+    hash_table_cursor cursor;
+    const char *key;
+    int  *value;
+    unsigned long nwords;
+    double read_time;
+    double tokenize_time;
+    double start;
+    double counted;
+
+    old_path = 0;
+    nthreads = 1;
+    k = 0;
+    ncounters = 0;
+    order = UNSORTED;
+    show_stats = 0;
+    report = 0;
+    normalize = 0;
+    use_filter = 0;
+    nwords = 0;
+    read_time = 0;
+    tokenize_time = 0;
+    items = NULL;
+    load_file = NULL;
+    save_file = NULL;
+    freeze_file = NULL;
+    query_file = NULL;
+    filename = NULL;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o"))
+        {
+            old_path = 1;
+        }
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            nthreads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+        {
+            k = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            ncounters = atol(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+        {
+            load_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            save_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-z") && i + 1 < argc)
+        {
+            freeze_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-q") && i + 1 < argc)
+        {
+            query_file = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-a"))
+        {
+            order = SORT_BY_KEY;
+        }
+        else if (!strcmp(argv[i], "-n"))
+        {
+            order = SORT_BY_COUNT;
+        }
+        else if (!strcmp(argv[i], "-t"))
+        {
+            show_stats = 1;
+        }
+        else if (!strcmp(argv[i], "-b"))
+        {
+            report = 1;
+        }
+        else if (!strcmp(argv[i], "-i"))
+        {
+            normalize = 1;
+        }
+        else if (!strcmp(argv[i], "-f"))
+        {
+            use_filter = 1;
+        }
+        else if (filename == NULL)
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
 
-    if (argc != 2)
+    if (filename == NULL || nthreads < 1 || nthreads > MAX_THREADS ||
+        (old_path && nthreads > 1) || k < 0 || ncounters < 0 ||
+        (ncounters > 0 && (old_path || nthreads > 1)) ||
+        (order != UNSORTED && (k > 0 || ncounters > 0)) ||
+        (ncounters > 0 && (load_file != NULL || save_file != NULL ||
+                           freeze_file != NULL || show_stats)) ||
+        (report && nthreads > 1) ||
+        (use_filter && (nthreads > 1 || ncounters > 0)) ||
+        (query_file != NULL && (old_path || nthreads > 1 || k > 0 ||
+                                ncounters > 0 || order != UNSORTED ||
+                                load_file != NULL || save_file != NULL ||
+                                freeze_file != NULL ||
+                                show_stats || report || use_filter)))
     {
         usage(argv[0]);
         exit(1);
     }
 
-    /* Make the hash table. */
-    ht = create_hash_table();
+    /* Streaming mode reports the top 100 words unless told otherwise. */
+    if (ncounters > 0 && k == 0)
+    {
+        k = 100;
+    }
+    if (k > 0)
+    {
+        items = (word_count *)malloc(k * sizeof(word_count));
+
+        if (items == NULL)
+        {
+            fprintf(stderr, "Error: memory allocation failed! "
+                            "Terminating program.\n");
+            return 1;
+        }
+
+        top_k_init(&heap, items, k);
+    }
 
     /*
-     * Open the input file.  For simplicity, we specify that the
-     * input file has to contain exactly one word per line.
+     * Open the input file.  Words are separated by any whitespace, so
+     * a line may hold any number of words, and words may be any length.
      */
-    input_file = fopen(argv[1], "r");
-
-    if (input_file == NULL)  /* Open failed. */
+    if (tokenizer_open(&input, filename) != 0)  /* Open failed. */
     {
         fprintf(stderr, "Input file \"%s\" does not exist! "
-                        "Terminating program.\n", argv[1]);
+                        "Terminating program.\n", filename);
         return 1;
     }
+    if (normalize)
+    {
+        tokenizer_normalize(&input);
+    }
 
-    /* Add the words to the hash table until there are none left. */
+    if (query_file != NULL)
+    {
+        /*
+         * Look every input word up in a frozen or saved table, without
+         * counting.
+         */
+        if (open_frozen_table(&frozen, query_file) == 0)
+        {
+            while (next_word(&input, &word, &len))
+            {
+                printf("%.*s %d\n", (int)len, word,
+                       frozen_get(&frozen, word, len));
+            }
+            close_frozen_table(&frozen);
+        }
+        else
+        {
+            open_saved_or_exit(&saved, query_file);
+            while (next_word(&input, &word, &len))
+            {
+                printf("%.*s %d\n", (int)len, word,
+                       saved_get(&saved, word, len));
+            }
+            close_saved_table(&saved);
+        }
 
-    while (fgets(line, MAX_WORD_LENGTH, input_file) != NULL)
+        tokenizer_close(&input);
+        print_memory_leaks();
+        return 0;
+    }
+
+    if (report)
     {
-        /* Clear the contents of 'word'. */
-        word[0] = '\0';
+        /*
+         * Tokenize the input twice before counting it: the first pass
+         * also reads the file in, and the second is the tokenizing part
+         * of the counting time.
+         */
+        read_time = time_tokenizing(&input, &nwords);
+        tokenize_time = time_tokenizing(&input, &nwords);
+        read_time -= tokenize_time;
+    }
+    start = now();
 
-        /* Convert the line to a word. */
-        nwords = sscanf(line, "%s", word);
+    if (ncounters > 0)
+    {
+        /* Track the heavy hitters without keeping every word. */
+        ss = create_space_saving(ncounters);
 
-        if (nwords != 1)  /* Conversion failed, e.g. due to a blank line. */
+        while (next_word(&input, &word, &len))
         {
-            continue;
+            space_saving_add(ss, word, len);
         }
-        else
+        counted = now();
+
+        top_k_space_saving(ss, &heap);
+        print_top_k(&heap);
+
+        if (report)
         {
-            /* Copy the word.  Add 1 for the zero byte at the end. */
-            new_word = (char *)calloc(strlen(word) + 1, sizeof(char));
+            fflush(stdout);
+            print_report(nwords, input.size, read_time, tokenize_time,
+                         counted - start, now() - counted);
+        }
 
-            if (new_word == NULL)
+        free(items);
+        free_space_saving(ss);
+        tokenizer_close(&input);
+        print_memory_leaks();
+        return 0;
+    }
+
+    if (nthreads > 1)
+    {
+        /* Count in parallel; the result comes in one table per shard. */
+        tables = parallel_count(&input, nthreads);
+        ntables = nthreads;
+    }
+    else
+    {
+        /* Make the hash table. */
+        ht = create_hash_table();
+        tables = &ht;
+        ntables = 1;
+        if (use_filter)
+        {
+            hash_table_use_filter(ht);
+        }
+
+        /* Add the words to the hash table until there are none left. */
+
+        while (next_word(&input, &word, &len))
+        {
+            if (!old_path)
             {
-                fprintf(stderr, "Error: memory allocation failed! "
-                                "Terminating program.\n");
-                return 1;
+                /*
+                 * Look the word up in place; it is copied only if it is
+                 * new to the table.
+                 */
+                increment_n(ht, word, len);
             }
+            else
+            {
+                /* Copy the word.  Add 1 for the zero byte at the end. */
+                new_word = (char *)calloc(len + 1, sizeof(char));
+
+                if (new_word == NULL)
+                {
+                    fprintf(stderr, "Error: memory allocation failed! "
+                                    "Terminating program.\n");
+                    return 1;
+                }
 
+                memcpy(new_word, word, len);
 
+                /* Add it to the hash table, which keeps its own copy. */
+                add_to_hash_table(ht, new_word);
+                free(new_word);
+            }
+        }
+    }
+
+    counted = now();
+
+    /* Count on top of an earlier run, and save the total for the next. */
+    if (load_file != NULL)
+    {
+        open_saved_or_exit(&saved, load_file);
+        add_saved_table(&saved, tables, ntables);
+        close_saved_table(&saved);
+    }
+    if (save_file != NULL && save_hash_tables(tables, ntables, save_file))
+    {
+        fprintf(stderr, "Cannot write \"%s\"! Terminating program.\n",
+                save_file);
+        return 1;
+    }
+    if (freeze_file != NULL &&
+        freeze_hash_tables(tables, ntables, freeze_file))
+    {
+        fprintf(stderr, "Cannot freeze the counts into \"%s\"! "
+                        "Terminating program.\n", freeze_file);
+        return 1;
+    }
 
-            strcpy(new_word, word);
+    if (show_stats)
+    {
+        for (i = 0; i < ntables; i++)
+        {
+            print_stats(tables[i], i);
+        }
+    }
 
-            /* Add it to the hash table. */
-            add_to_hash_table(ht, new_word);
+    /* Print out the hash table key/value pairs, or just the top K. */
+    if (order != UNSORTED)
+    {
+        print_sorted(tables, ntables, order);
+    }
+    else if (k > 0)
+    {
+        for (i = 0; i < ntables; i++)
+        {
+            top_k_hash_table(tables[i], &heap);
+        }
+        print_top_k(&heap);
+        free(items);
+    }
+    else
+    {
+        for (i = 0; i < ntables; i++)
+        {
+            hash_table_begin(&cursor);
+            while (hash_table_next(tables[i], &cursor, &key, &value))
+            {
+                printf("%s %d\n", key, *value);
+            }
         }
     }
 
-    /* Print out the hash table key/value pairs. */
-    print_hash_table(ht);
+    if (report)
+    {
+        fflush(stdout);
+        print_report(nwords, input.size, read_time, tokenize_time,
+                     counted - start, now() - counted);
+    }
 
     /* Clean up. */
-    free_hash_table(ht);
-    fclose(input_file);
+    if (nthreads > 1)
+    {
+        free_shards(tables, ntables);
+    }
+    else
+    {
+        free_hash_table(ht);
+    }
+    tokenizer_close(&input);
 
     /* Check for memory leaks. */
     print_memory_leaks();
@@ -0,0 +1,735 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: oa_hash_table.c
+ *
+ *       Implementation of the hash table functionality using open
+ *       addressing.  This engine has the same interface as the chaining
+ *       engine in hash_table.c, so a program can be linked against
+ *       either one.
+ *
+ *       All entries live in one flat array of (hash, key, value)
+ *       records and collisions are resolved by linear probing, so a
+ *       lookup walks consecutive memory instead of chasing a pointer
+ *       per node.  Deletion shifts the following entries of the probe
+ *       run back into the hole, so no tombstones are ever left behind.
+ *
+ *       Growing is incremental: a twice as large array is allocated and
+ *       each later insertion copies a few slots of the old array across,
+ *       so no single call has to rehash the whole table.
+ *
+ *       Short keys are stored inside their slots; longer ones are
+ *       copied into an arena owned by the table, so freeing the table
+ *       releases a few large chunks instead of every key.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_table.h"
+#include "hash_func.h"
+#include "arena.h"
+#include "bloom_filter.h"
+#include "memcheck.h"
+
+/* Number of slots in a table created without a capacity hint. */
+#define INITIAL_CAPACITY 128
+
+/* Smallest table create_hash_table_sized() will build. */
+#define MIN_CAPACITY 8
+
+/*
+ * The table grows when more than MAX_LOAD_NUM / MAX_LOAD_DEN of the
+ * entries are in use.  Linear probing degrades quickly past ~75%.
+ */
+#define MAX_LOAD_NUM 3
+#define MAX_LOAD_DEN 4
+
+/*
+ * Number of old slots copied into the new array by each insertion
+ * while the table is growing.  The new array starts at most 3/8 full
+ * and reaches its own threshold after 3/4 * old capacity insertions,
+ * so anything above 4/3 slots per insertion drains the old array in
+ * time.
+ */
+#define REHASH_STEP 8
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * A single slot of the table.  A slot whose 'size' is 0 is empty.
+ * The full hash and the key length are cached so that probing can skip
+ * most string compares and growing never has to rehash a key.
+ *
+ * Keys shorter than INLINE_KEY bytes, which are most words, are stored
+ * in the slot itself, so a probe that finds its key touches one cache
+ * line and no other memory.  Longer keys are copied into the arena.
+ * Either way KEY_OF() gives the zero terminated key.
+ */
+
+#define INLINE_KEY 16
+
+typedef struct
+{
+    unsigned long hash;
+    unsigned int size;              /* key length + 1, or 0 if empty */
+    int value;
+    union
+    {
+        char text[INLINE_KEY];      /* a short key and its zero byte */
+        char *ptr;                  /* a long key, in the arena */
+    } key;
+} entry;
+
+#define IS_EMPTY(e) ((e)->size == 0)
+#define KEY_LEN(e) ((size_t) (e)->size - 1)
+#define KEY_OF(e) ((e)->size <= INLINE_KEY ? (e)->key.text : (e)->key.ptr)
+
+/*
+ * While the table grows, 'old_entries' is the array being drained.
+ * Its slots below 'rehash_pos' have already been copied into
+ * 'entries' and are ignored; the rest are still live.  The old array
+ * is never modified, so its probe runs stay intact until it is freed.
+ */
+
+struct _hash_table
+{
+    entry *entries;
+    unsigned long mask;         /* capacity - 1; capacity is a power of 2 */
+    entry *old_entries;         /* array being drained, or NULL */
+    unsigned long old_mask;
+    unsigned long rehash_pos;   /* next old slot to copy across */
+    unsigned long count;        /* number of keys in the table */
+    arena keys;                 /* copies of the keys */
+    bloom_filter *filter;       /* see hash_table_use_filter(), or NULL */
+};
+
+
+/*
+ * Function prototypes for the engine's private utilities.
+ */
+
+entry *alloc_entries(unsigned long capacity);
+entry *probe(entry *arr, unsigned long mask, const char *key, size_t len,
+             unsigned long h);
+entry *find_entry(hash_table *ht, const char *key, size_t len,
+                  unsigned long h);
+entry *add_entry(hash_table *ht, entry *e, const char *key, size_t len,
+                 unsigned long h, int value);
+void rehash_step(hash_table *ht, unsigned long nslots);
+void grow_table(hash_table *ht);
+void add_probe_lengths(hash_stats *stats, entry *arr, unsigned long mask,
+                       unsigned long from);
+void filter_insert(hash_table *ht, unsigned long h);
+void refill_filter(hash_table *ht);
+
+
+/*** Slot array utilities. ***/
+
+/* Allocate an array of 'capacity' empty entries. */
+entry *alloc_entries(unsigned long capacity)
+{
+    entry *arr = (entry *) calloc(capacity, sizeof(entry));
+
+    if (arr == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    return arr;
+}
+
+
+/*
+ * Return the slot of 'arr' holding the 'len' bytes at 'key' (whose
+ * hash is 'h'), or the empty slot that ends its probe run if the key
+ * is not there.
+ */
+entry *probe(entry *arr, unsigned long mask, const char *key, size_t len,
+             unsigned long h)
+{
+    unsigned long i;
+    entry *e;
+
+    for (i = h & mask; ; i = (i + 1) & mask) {
+        e = &arr[i];
+        if (IS_EMPTY(e)) {
+            return e;
+        }
+        if (e->hash == h && e->size == len + 1 &&
+            !memcmp(KEY_OF(e), key, len)) {
+            return e;
+        }
+    }
+}
+
+
+/*
+ * Return the live slot holding 'key', or the empty slot of the current
+ * array where it would be inserted if the key is not in the table.
+ */
+entry *find_entry(hash_table *ht, const char *key, size_t len,
+                  unsigned long h)
+{
+    entry *e, *old;
+
+    e = probe(ht->entries, ht->mask, key, len, h);
+    if (IS_EMPTY(e) && ht->old_entries != NULL) {
+        old = probe(ht->old_entries, ht->old_mask, key, len, h);
+        if (!IS_EMPTY(old) &&
+            (unsigned long) (old - ht->old_entries) >= ht->rehash_pos) {
+            return old;
+        }
+    }
+    return e;
+}
+
+
+/*
+ * Store a new key in the empty slot 'e' returned by find_entry(),
+ * growing the table first if it is too full.  The key is copied into
+ * the table's arena.  Return the slot that was filled.
+ */
+entry *add_entry(hash_table *ht, entry *e, const char *key, size_t len,
+                 unsigned long h, int value)
+{
+    if ((ht->count + 1) * MAX_LOAD_DEN > (ht->mask + 1) * MAX_LOAD_NUM) {
+        grow_table(ht);
+        e = probe(ht->entries, ht->mask, key, len, h);
+    }
+    e->hash = h;
+    e->size = (unsigned int) len + 1;
+    if (len < INLINE_KEY) {
+        memcpy(e->key.text, key, len);
+        e->key.text[len] = '\0';
+    }
+    else {
+        e->key.ptr = arena_strdup(&ht->keys, key, len);
+    }
+    e->value = value;
+    ht->count++;
+    filter_insert(ht, h);
+    return e;
+}
+
+
+/*
+ * Copy up to 'nslots' slots of the old array into the current one, and
+ * release the old array once it has been drained.  Keys in the old
+ * array are never in the current one, so each copy just takes the first
+ * empty slot of its probe run.
+ */
+void rehash_step(hash_table *ht, unsigned long nslots)
+{
+    unsigned long j;
+    entry *old;
+
+    while (ht->old_entries != NULL && nslots-- > 0) {
+        old = &ht->old_entries[ht->rehash_pos];
+        if (!IS_EMPTY(old)) {
+            j = old->hash & ht->mask;
+            while (!IS_EMPTY(&ht->entries[j])) {
+                j = (j + 1) & ht->mask;
+            }
+            ht->entries[j] = *old;
+        }
+
+        if (ht->rehash_pos++ == ht->old_mask) {
+            free(ht->old_entries);
+            ht->old_entries = NULL;
+        }
+    }
+}
+
+
+/*
+ * Start growing the table: the current array becomes the old one and
+ * an empty array of twice the capacity takes its place.  A previous
+ * growth step that has not finished yet is completed first.
+ */
+void grow_table(hash_table *ht)
+{
+    rehash_step(ht, ht->old_mask + 1);
+
+    ht->old_entries = ht->entries;
+    ht->old_mask = ht->mask;
+    ht->rehash_pos = 0;
+    ht->mask = 2 * ht->mask + 1;
+    ht->entries = alloc_entries(ht->mask + 1);
+}
+
+
+/*** Hash table utilities. ***/
+
+/* Create a new hash table. */
+hash_table *create_hash_table()
+{
+    return create_hash_table_sized(INITIAL_CAPACITY * MAX_LOAD_NUM
+                                   / MAX_LOAD_DEN);
+}
+
+
+/*
+ * Create a hash table sized for about 'capacity_hint' keys, so that
+ * tables whose final size is known up front never have to grow.
+ */
+hash_table *create_hash_table_sized(unsigned long capacity_hint)
+{
+    unsigned long capacity;
+    hash_table *ht;
+
+    ht = (hash_table *) malloc(sizeof(hash_table));
+    if (ht == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    capacity = MIN_CAPACITY;
+    while (capacity * MAX_LOAD_NUM / MAX_LOAD_DEN < capacity_hint) {
+        capacity *= 2;
+    }
+    ht->entries = alloc_entries(capacity);
+    ht->mask = capacity - 1;
+    ht->old_entries = NULL;
+    ht->old_mask = 0;
+    ht->rehash_pos = 0;
+    ht->count = 0;
+    arena_init(&ht->keys);
+    ht->filter = NULL;
+    return ht;
+}
+
+
+/*
+ * Free a hash table.  The keys all live in the slots or the arena, so
+ * the slots never have to be scanned.
+ */
+void free_hash_table(hash_table *ht)
+{
+    if (ht->old_entries != NULL) {
+        free(ht->old_entries);
+    }
+    free(ht->entries);
+    arena_free(&ht->keys);
+    if (ht->filter != NULL) {
+        free_bloom_filter(ht->filter);
+    }
+    free(ht);
+}
+
+
+/*
+ * Look for a key in the hash table.  Return 0 if not found.
+ * If it is found return the associated value.
+ */
+int get_value(hash_table *ht, char *key)
+{
+    size_t len = strlen(key);
+    unsigned long h = hash_string(key, len);
+    entry *e;
+
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    e = find_entry(ht, key, len, h);
+    if (IS_EMPTY(e)) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
+        }
+        return 0;
+    }
+    return e->value;
+}
+
+
+/*
+ * Set the value stored at a key.  If the key is not in the table,
+ * create a new entry and set the value to 'value'.  Note that this
+ * function alters the hash table that was passed to it.  The table
+ * stores its own copy of 'key'.
+ */
+void set_value(hash_table *ht, char *key, int value)
+{
+    unsigned long h;
+    size_t len;
+    entry *e;
+
+    rehash_step(ht, REHASH_STEP);
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    e = find_entry(ht, key, len, h);
+
+    /* The 1st case handles if the key already exists in the hash table */
+    if (!IS_EMPTY(e)) {
+        e->value = value;
+        return;
+    }
+
+    /* The 2nd case fills the empty slot that ended the probe run. */
+    add_entry(ht, e, key, len, h, value);
+}
+
+
+/*
+ * Return a pointer to the value stored at a key, inserting the key
+ * with a value of 0 if it is not in the table yet.  The key is hashed
+ * and probed once and copied only if it is new.  The pointer is valid
+ * until the table is next modified.
+ */
+int *find_or_insert(hash_table *ht, char *key)
+{
+    return find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as find_or_insert, for a key given as 'len' bytes that need
+ * not be zero terminated.
+ */
+int *find_or_insert_n(hash_table *ht, const char *key, size_t len)
+{
+    return find_or_insert_hashed(ht, key, len, hash_string(key, len));
+}
+
+
+/*
+ * The same as find_or_insert_n, for a key whose hash_string() value
+ * 'h' the caller has already computed.
+ */
+int *find_or_insert_hashed(hash_table *ht, const char *key, size_t len,
+                           unsigned long h)
+{
+    entry *e;
+
+    rehash_step(ht, REHASH_STEP);
+
+    e = find_entry(ht, key, len, h);
+    if (IS_EMPTY(e)) {
+        e = add_entry(ht, e, key, len, h, 0);
+    }
+    return &e->value;
+}
+
+
+/*
+ * Add one to the value stored at a key, inserting the key with a value
+ * of 1 if it is not in the table yet.  Return the new value.
+ */
+int increment(hash_table *ht, char *key)
+{
+    return ++*find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as increment, for a key given as 'len' bytes that need not
+ * be zero terminated.
+ */
+int increment_n(hash_table *ht, const char *key, size_t len)
+{
+    return ++*find_or_insert_n(ht, key, len);
+}
+
+
+/*
+ * Remove a key from the hash table.  Return 1 if the key was found and
+ * removed, otherwise 0.  The copy of the key is reclaimed only when
+ * the table is freed.
+ *
+ * Instead of marking the slot with a tombstone, every later entry of
+ * the probe run that may legally sit in the hole is shifted back into
+ * it, so lookups never have to step over deleted slots.  Removal is
+ * rare, so a pending growth step is simply finished first rather than
+ * teaching the shift about the old array.
+ */
+int remove_key(hash_table *ht, char *key)
+{
+    unsigned long h, hole, j, home;
+    size_t len;
+    entry *e;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    if (ht->old_entries != NULL) {
+        rehash_step(ht, ht->old_mask + 1);
+    }
+    e = probe(ht->entries, ht->mask, key, len, h);
+    if (IS_EMPTY(e)) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
+        }
+        return 0;
+    }
+
+    hole = (unsigned long) (e - ht->entries);
+    for (j = (hole + 1) & ht->mask; !IS_EMPTY(&ht->entries[j]);
+         j = (j + 1) & ht->mask) {
+        home = ht->entries[j].hash & ht->mask;
+        /* Move the entry only if the hole lies on its probe path. */
+        if (((j - home) & ht->mask) >= ((j - hole) & ht->mask)) {
+            ht->entries[hole] = ht->entries[j];
+            hole = j;
+        }
+    }
+    ht->entries[hole].size = 0;
+    ht->count--;
+    return 1;
+}
+
+
+/*
+ * Add the value of every key of 'src' to the value of the same key in
+ * 'dst', inserting keys that 'dst' does not have yet.  'src' is not
+ * changed.  The cached hashes are reused, so no key is hashed again.
+ */
+void merge_hash_tables(hash_table *dst, hash_table *src)
+{
+    unsigned long i;
+    entry *e;
+
+    if (src->old_entries != NULL) {
+        for (i = src->rehash_pos; i <= src->old_mask; i++) {
+            e = &src->old_entries[i];
+            if (!IS_EMPTY(e)) {
+                *find_or_insert_hashed(dst, KEY_OF(e), KEY_LEN(e),
+                                       e->hash) += e->value;
+            }
+        }
+    }
+    for (i = 0; i <= src->mask; i++) {
+        e = &src->entries[i];
+        if (!IS_EMPTY(e)) {
+            *find_or_insert_hashed(dst, KEY_OF(e), KEY_LEN(e), e->hash) +=
+                e->value;
+        }
+    }
+}
+
+
+/* Offer every key of the hash table and its value to a top K heap. */
+void top_k_hash_table(hash_table *ht, top_k *heap)
+{
+    unsigned long i;
+    entry *e;
+
+    if (ht->old_entries != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            e = &ht->old_entries[i];
+            if (!IS_EMPTY(e)) {
+                top_k_offer(heap, KEY_OF(e), e->value);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        e = &ht->entries[i];
+        if (!IS_EMPTY(e)) {
+            top_k_offer(heap, KEY_OF(e), e->value);
+        }
+    }
+}
+
+
+/* Return the number of keys in the hash table. */
+unsigned long hash_table_size(hash_table *ht)
+{
+    return ht->count;
+}
+
+
+/*
+ * Store every key and its value in 'out'.  Short keys point into the
+ * slots, so they are only valid until the table is next modified.
+ */
+unsigned long collect_hash_table(hash_table *ht, word_count *out)
+{
+    unsigned long i, n;
+    entry *e;
+
+    n = 0;
+    if (ht->old_entries != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            e = &ht->old_entries[i];
+            if (!IS_EMPTY(e)) {
+                out[n].key = KEY_OF(e);
+                out[n++].value = e->value;
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        e = &ht->entries[i];
+        if (!IS_EMPTY(e)) {
+            out[n].key = KEY_OF(e);
+            out[n++].value = e->value;
+        }
+    }
+    return n;
+}
+
+
+/* Print out the contents of the hash table as key/value pairs. */
+void print_hash_table(hash_table *ht)
+{
+    unsigned long i;
+    entry *e;
+
+    if (ht->old_entries != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            e = &ht->old_entries[i];
+            if (!IS_EMPTY(e)) {
+                printf("%s %d\n", KEY_OF(e), e->value);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        e = &ht->entries[i];
+        if (!IS_EMPTY(e)) {
+            printf("%s %d\n", KEY_OF(e), e->value);
+        }
+    }
+}
+
+
+/*** Iteration and statistics. ***/
+
+/*
+ * The cursor's 'pos' counts the slots already looked at: those of the
+ * old array from 'rehash_pos' on, then those of the current one.
+ */
+void hash_table_begin(hash_table_cursor *c)
+{
+    c->pos = 0;
+    c->link = NULL;
+}
+
+
+int hash_table_next(hash_table *ht, hash_table_cursor *c,
+                    const char **key, int **value)
+{
+    unsigned long nold;
+    entry *e;
+
+    nold = (ht->old_entries != NULL) ? ht->old_mask + 1 - ht->rehash_pos
+                                     : 0;
+    while (c->pos < nold + ht->mask + 1) {
+        if (c->pos < nold) {
+            e = &ht->old_entries[ht->rehash_pos + c->pos];
+        }
+        else {
+            e = &ht->entries[c->pos - nold];
+        }
+        c->pos++;
+
+        if (!IS_EMPTY(e)) {
+            *key = KEY_OF(e);
+            *value = &e->value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Add the probe length of every key in the slots of 'arr' from 'from'
+ * on to the histogram: one more than the distance from its home slot.
+ */
+void add_probe_lengths(hash_stats *stats, entry *arr, unsigned long mask,
+                       unsigned long from)
+{
+    unsigned long i, len;
+
+    for (i = from; i <= mask; i++) {
+        if (!IS_EMPTY(&arr[i])) {
+            len = ((i - arr[i].hash) & mask) + 1;
+            stats->histogram[len < HASH_STATS_LENGTHS
+                             ? len : HASH_STATS_LENGTHS - 1]++;
+            if (len > stats->max_length) {
+                stats->max_length = len;
+            }
+            stats->mean_length += len;
+        }
+    }
+}
+
+
+void hash_table_stats(hash_table *ht, hash_stats *stats)
+{
+    memset(stats, 0, sizeof(hash_stats));
+    stats->keys = ht->count;
+    stats->slots = ht->mask + 1;
+    if (ht->old_entries != NULL) {
+        stats->slots += ht->old_mask + 1 - ht->rehash_pos;
+        add_probe_lengths(stats, ht->old_entries, ht->old_mask,
+                          ht->rehash_pos);
+    }
+    add_probe_lengths(stats, ht->entries, ht->mask, 0);
+
+    stats->load_factor = (double) stats->keys / stats->slots;
+    if (stats->keys > 0) {
+        stats->mean_length /= stats->keys;
+    }
+    if (ht->filter != NULL) {
+        stats->filter_checks = ht->filter->checks;
+        stats->filter_rejects = ht->filter->rejects;
+        stats->filter_false_positives = ht->filter->false_positives;
+    }
+}
+
+/*** Negative lookup filter. ***/
+
+/*
+ * Add a new key's hash to the filter, if the table has one.  Once the
+ * keys outgrow the filter it is rebuilt twice as large, which also
+ * drops the keys removed since it was last built.
+ */
+void filter_insert(hash_table *ht, unsigned long h)
+{
+    if (ht->filter == NULL) {
+        return;
+    }
+    if (ht->count <= ht->filter->capacity) {
+        bloom_add(ht->filter, h);
+    }
+    else {
+        clear_bloom_filter(ht->filter, 2 * ht->filter->capacity);
+        refill_filter(ht);
+    }
+}
+
+
+/* Add every key of the table to its filter, from the cached hashes. */
+void refill_filter(hash_table *ht)
+{
+    unsigned long i;
+
+    if (ht->old_entries != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            if (!IS_EMPTY(&ht->old_entries[i])) {
+                bloom_add(ht->filter, ht->old_entries[i].hash);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        if (!IS_EMPTY(&ht->entries[i])) {
+            bloom_add(ht->filter, ht->entries[i].hash);
+        }
+    }
+}
+
+
+void hash_table_use_filter(hash_table *ht)
+{
+    if (ht->filter == NULL) {
+        ht->filter = create_bloom_filter(2 * ht->count + INITIAL_CAPACITY);
+        refill_filter(ht);
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: parallel_count.c
+ *
+ *       Implementation of the multithreaded word counter.
+ *
+ *       With N threads there are N * N tables: table [t][s] holds the
+ *       words of shard s that thread t found in its part of the input.
+ *       A word's shard comes from hash_shard() in hash_func.h.
+ *       In the merge step thread s folds the tables [t][s] of every
+ *       other thread t into table [0][s], so no two threads ever touch
+ *       the same table.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "parallel_count.h"
+#include "hash_func.h"
+#include "memcheck.h"
+
+
+/* The work of one thread. */
+typedef struct
+{
+    int id;
+    int nthreads;
+    tokenizer part;         /* this thread's part of the input */
+    hash_table ***tables;   /* tables[thread][shard] */
+} worker;
+
+
+void *count_part(void *arg);
+void *merge_shard(void *arg);
+void run_workers(worker *workers, int nthreads, void *(*fn)(void *));
+
+
+/* Phase 1: count one part of the input into this thread's tables. */
+void *count_part(void *arg)
+{
+    worker *w = (worker *) arg;
+    hash_table **mine = w->tables[w->id];
+    const char *word;
+    unsigned long h;
+    size_t len;
+
+    while (next_word(&w->part, &word, &len)) {
+        h = hash_string(word, len);
+        ++*find_or_insert_hashed(mine[hash_shard(h, w->nthreads)],
+                                 word, len, h);
+    }
+    return NULL;
+}
+
+
+/* Phase 2: fold every thread's table for one shard into the first. */
+void *merge_shard(void *arg)
+{
+    worker *w = (worker *) arg;
+    int t;
+
+    for (t = 1; t < w->nthreads; t++) {
+        merge_hash_tables(w->tables[0][w->id], w->tables[t][w->id]);
+        free_hash_table(w->tables[t][w->id]);
+        w->tables[t][w->id] = NULL;
+    }
+    return NULL;
+}
+
+
+/*
+ * Run 'fn' on every worker, one thread each, and wait for all of them.
+ * The calling thread takes the first worker itself.
+ */
+void run_workers(worker *workers, int nthreads, void *(*fn)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    int i;
+
+    for (i = 1; i < nthreads; i++) {
+        if (pthread_create(&threads[i], NULL, fn, &workers[i]) != 0) {
+            fprintf(stderr, "Fatal error: cannot start a thread. "
+                    "Terminating program.\n");
+            exit(1);
+        }
+    }
+    fn(&workers[0]);
+    for (i = 1; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+
+hash_table **parallel_count(tokenizer *input, int nthreads)
+{
+    tokenizer parts[MAX_THREADS];
+    worker workers[MAX_THREADS];
+    hash_table ***tables;
+    hash_table **shards;
+    int t, s;
+
+    tables = (hash_table ***) malloc(nthreads * sizeof(hash_table **));
+    if (tables == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    for (t = 0; t < nthreads; t++) {
+        tables[t] = (hash_table **) malloc(nthreads * sizeof(hash_table *));
+        if (tables[t] == NULL) {
+            fprintf(stderr, "Fatal error: out of memory. "
+                    "Terminating program.\n");
+            exit(1);
+        }
+        for (s = 0; s < nthreads; s++) {
+            tables[t][s] = create_hash_table();
+        }
+    }
+
+    tokenizer_split(input, parts, nthreads);
+    for (t = 0; t < nthreads; t++) {
+        workers[t].id = t;
+        workers[t].nthreads = nthreads;
+        workers[t].part = parts[t];
+        workers[t].tables = tables;
+    }
+
+    run_workers(workers, nthreads, count_part);
+    run_workers(workers, nthreads, merge_shard);
+    for (t = 0; t < nthreads; t++) {
+        tokenizer_close(&workers[t].part);
+    }
+
+    /* Only the first row of tables is left; it holds every shard. */
+    shards = tables[0];
+    for (t = 1; t < nthreads; t++) {
+        free(tables[t]);
+    }
+    free(tables);
+    return shards;
+}
+
+
+void free_shards(hash_table **shards, int nthreads)
+{
+    int s;
+
+    for (s = 0; s < nthreads; s++) {
+        free_hash_table(shards[s]);
+    }
+    free(shards);
+}
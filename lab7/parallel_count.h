@@ -0,0 +1,34 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: parallel_count.h
+ *
+ *       Declaration of the multithreaded word counter.
+ *
+ */
+
+#ifndef PARALLEL_COUNT_H
+#define PARALLEL_COUNT_H
+
+#include "hash_table.h"
+#include "tokenizer.h"
+
+/* Most threads parallel_count() will start. */
+#define MAX_THREADS 256
+
+/*
+ * Count the words of 'input' with 'nthreads' threads.  The input is
+ * split into one part per thread at word boundaries, and every thread
+ * counts its part into tables of its own, one per shard of the key
+ * space.  The threads then merge the tables shard by shard, again in
+ * parallel, without any locking.
+ *
+ * Return an array of 'nthreads' tables whose key sets are disjoint;
+ * together they hold the counts of the whole input.
+ */
+hash_table **parallel_count(tokenizer *input, int nthreads);
+
+/* Free the tables returned by parallel_count(), and the array. */
+void free_shards(hash_table **shards, int nthreads);
+
+#endif  /* PARALLEL_COUNT_H */
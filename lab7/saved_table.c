@@ -0,0 +1,216 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: saved_table.c
+ *
+ *       Implementation of the saved table file format.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "saved_table.h"
+#include "word_output.h"
+#include "memcheck.h"
+
+#define SAVED_MAGIC "WCOUNT1"
+#define SAVED_BYTE_ORDER 0x01020304UL
+
+/* A saved table is at most half full. */
+#define MIN_SAVED_SLOTS 8
+
+/*
+ * The name of the hash function in use, without its "hash_" prefix,
+ * e.g. "words" when HASH_FUNC is hash_words.
+ */
+#define STRINGIFY(x) #x
+#define NAME_OF(x) STRINGIFY(x)
+#define HASH_NAME (NAME_OF(HASH_FUNC) + 5)
+
+/* Nonzero if a slot's key lies inside the pool. */
+#define KEY_IN_POOL(st, s) \
+    ((s)->key < (st)->header->pool_size && \
+     (s)->len < (st)->header->pool_size - (s)->key)
+
+
+/*
+ * The file is written under a temporary name and renamed into place
+ * when complete, so a failed run never leaves a truncated table behind
+ * in place of a good one.
+ */
+int save_hash_tables(hash_table **tables, int ntables,
+                     const char *filename)
+{
+    saved_header header;
+    saved_slot *slots;
+    word_count *words;
+    unsigned long n, i, j, h, nslots, offset;
+    size_t len;
+    char *tmpname;
+    FILE *f;
+    int ok;
+
+    words = gather_hash_tables(tables, ntables, &n);
+
+    nslots = MIN_SAVED_SLOTS;
+    while (nslots < 2 * n) {
+        nslots *= 2;
+    }
+    slots = (saved_slot *) calloc(nslots, sizeof(saved_slot));
+    tmpname = (char *) malloc(strlen(filename) + 5);
+    if (slots == NULL || tmpname == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    /* Lay the keys out in the pool in word order, after a zero byte. */
+    offset = 1;
+    for (i = 0; i < n; i++) {
+        len = strlen(words[i].key);
+        h = hash_string(words[i].key, len);
+        for (j = h & (nslots - 1); slots[j].key != 0;
+             j = (j + 1) & (nslots - 1)) {
+            /* Keep probing. */
+        }
+        slots[j].hash = h;
+        slots[j].key = offset;
+        slots[j].len = (unsigned int) len;
+        slots[j].value = words[i].value;
+        offset += len + 1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAVED_MAGIC, sizeof(SAVED_MAGIC));
+    header.byte_order = SAVED_BYTE_ORDER;
+    header.nslots = nslots;
+    header.nkeys = n;
+    header.pool_size = offset;
+    strncpy(header.hash_name, HASH_NAME, sizeof(header.hash_name) - 1);
+
+    sprintf(tmpname, "%s.tmp", filename);
+    f = fopen(tmpname, "wb");
+    ok = f != NULL;
+    if (ok) {
+        fwrite(&header, sizeof(header), 1, f);
+        fwrite(slots, sizeof(saved_slot), nslots, f);
+        fputc('\0', f);
+        for (i = 0; i < n; i++) {
+            fwrite(words[i].key, 1, strlen(words[i].key) + 1, f);
+        }
+        ok = !ferror(f);
+        ok = fclose(f) == 0 && ok;
+        ok = ok && rename(tmpname, filename) == 0;
+        if (!ok) {
+            remove(tmpname);
+        }
+    }
+
+    free(tmpname);
+    free(slots);
+    free(words);
+    return ok ? 0 : -1;
+}
+
+
+int open_saved_table(saved_table *st, const char *filename)
+{
+    const saved_header *header;
+    struct stat sb;
+    void *map;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < sizeof(saved_header)) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    /* Check that the header describes this file exactly. */
+    header = (const saved_header *) map;
+    st->map = map;
+    st->size = (size_t) sb.st_size;
+    st->header = header;
+    st->hash = NULL;
+    if (memcmp(header->magic, SAVED_MAGIC, sizeof(SAVED_MAGIC)) == 0 &&
+        header->byte_order == SAVED_BYTE_ORDER &&
+        header->nslots > 0 && (header->nslots & (header->nslots - 1)) == 0 &&
+        header->nslots <= st->size / sizeof(saved_slot) &&
+        header->nkeys < header->nslots &&
+        header->pool_size > 0 &&
+        st->size == sizeof(saved_header) +
+                    header->nslots * sizeof(saved_slot) +
+                    header->pool_size &&
+        memchr(header->hash_name, '\0', sizeof(header->hash_name))) {
+        st->hash = find_hash_fn(header->hash_name);
+    }
+    if (st->hash == NULL) {
+        munmap(map, st->size);
+        return -1;
+    }
+
+    st->slots = (const saved_slot *) (header + 1);
+    st->pool = (const char *) (st->slots + header->nslots);
+    return 0;
+}
+
+
+int saved_get(const saved_table *st, const char *key, size_t len)
+{
+    const saved_slot *s;
+    unsigned long h, i, n, mask;
+
+    /* Probe no more than every slot, in case the file has no empty one. */
+    mask = st->header->nslots - 1;
+    h = st->hash(key, len);
+    for (i = h & mask, n = 0; n <= mask && st->slots[i].key != 0;
+         i = (i + 1) & mask, n++) {
+        s = &st->slots[i];
+        if (s->hash == h && s->len == len && KEY_IN_POOL(st, s) &&
+            !memcmp(st->pool + s->key, key, len)) {
+            return s->value;
+        }
+    }
+    return 0;
+}
+
+
+void add_saved_table(const saved_table *st, hash_table **tables,
+                     int ntables)
+{
+    const saved_slot *s;
+    unsigned long i, h;
+    int same_hash;
+
+    same_hash = st->hash == HASH_FUNC;
+    for (i = 0; i < st->header->nslots; i++) {
+        s = &st->slots[i];
+        if (s->key == 0 || !KEY_IN_POOL(st, s)) {
+            continue;
+        }
+        h = same_hash ? s->hash : hash_string(st->pool + s->key, s->len);
+        *find_or_insert_hashed(tables[hash_shard(h, ntables)],
+                               st->pool + s->key, s->len, h) += s->value;
+    }
+}
+
+
+void close_saved_table(saved_table *st)
+{
+    munmap(st->map, st->size);
+}
@@ -0,0 +1,91 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: saved_table.h
+ *
+ *       Declaration of a file format for word counts, so that a count
+ *       can be kept from one run to the next.
+ *
+ *       A saved table is a header, a flat open addressing array of
+ *       slots and a pool of zero terminated keys.  Slots refer to keys
+ *       by their offset in the pool rather than by pointer, so the file
+ *       is used exactly as it lies on disk: opening it maps it into
+ *       memory and checks the header, which takes the same time however
+ *       large the table is, and lookups probe the mapped slots directly.
+ *
+ *       Slots keep the full hash of their key, and the header names the
+ *       hash function, so a saved table can be read by a program built
+ *       with any hash function.  Files are not portable between
+ *       machines with different byte orders or word sizes.
+ *
+ */
+
+#ifndef SAVED_TABLE_H
+#define SAVED_TABLE_H
+
+#include <stddef.h>
+#include "hash_table.h"
+#include "hash_func.h"
+
+/* A file header, as it lies on disk. */
+typedef struct
+{
+    char magic[8];              /* SAVED_MAGIC */
+    unsigned long byte_order;   /* SAVED_BYTE_ORDER as written */
+    unsigned long nslots;       /* a power of two */
+    unsigned long nkeys;
+    unsigned long pool_size;    /* bytes of keys */
+    char hash_name[16];         /* as known to find_hash_fn() */
+} saved_header;
+
+/* A slot, as it lies on disk. */
+typedef struct
+{
+    unsigned long hash;
+    unsigned long key;          /* offset of the key in the pool, or 0 */
+    unsigned int len;
+    int value;
+} saved_slot;
+
+/* An open saved table. */
+typedef struct
+{
+    void *map;
+    size_t size;
+    const saved_header *header;
+    const saved_slot *slots;
+    const char *pool;
+    hash_fn hash;               /* the function the slots were hashed by */
+} saved_table;
+
+/*
+ * Save the words of 'ntables' tables, whose key sets must be disjoint
+ * (such as the shards of parallel_count()), to 'filename' as one
+ * table.  Return 0 on success or -1 if the file cannot be written.
+ */
+int save_hash_tables(hash_table **tables, int ntables,
+                     const char *filename);
+
+/*
+ * Map a saved table for reading.  Return 0 on success or -1 if the
+ * file cannot be mapped or is not a valid saved table.
+ */
+int open_saved_table(saved_table *st, const char *filename);
+
+/* Return the count of the 'len' bytes at 'key', or 0 if there is none. */
+int saved_get(const saved_table *st, const char *key, size_t len);
+
+/*
+ * Add every count of a saved table to 'ntables' tables, such as the
+ * shards of parallel_count(): each key goes to the table picked by
+ * hash_shard().  This lets new input be counted on top of an old
+ * count.  When the saved hash function is the one in use, the saved
+ * hashes are reused rather than computed again.
+ */
+void add_saved_table(const saved_table *st, hash_table **tables,
+                     int ntables);
+
+/* Unmap a saved table. */
+void close_saved_table(saved_table *st);
+
+#endif  /* SAVED_TABLE_H */
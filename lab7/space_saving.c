@@ -0,0 +1,283 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: space_saving.c
+ *
+ *       Implementation of the Space Saving word counter.
+ *
+ *       The counters sit in a fixed array.  A min heap of counter
+ *       numbers, ordered by count, finds the counter to take over in
+ *       O(1) and restores its order in O(log M) after each update, and
+ *       an open addressing index from words to counter numbers finds a
+ *       tracked word in O(1).  Nothing is allocated per word, except
+ *       when a counter needs a longer key buffer than it had; buffers
+ *       come from an arena, and since each new one is at least twice as
+ *       large as the one it replaces, the abandoned ones waste no more
+ *       memory than the live ones use.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "space_saving.h"
+#include "hash_func.h"
+#include "arena.h"
+#include "memcheck.h"
+
+/* Marks an unused slot of the index. */
+#define NO_COUNTER ((size_t) -1)
+
+
+/*
+ * Data structure definitions.
+ */
+
+typedef struct
+{
+    char *key;              /* zero terminated copy of the word */
+    size_t size;            /* room in 'key' */
+    unsigned int len;
+    unsigned long hash;
+    int count;
+    size_t pos;             /* where this counter sits in the heap */
+} counter;
+
+struct _space_saving
+{
+    counter *counters;
+    size_t ncounters;       /* counters in use */
+    size_t max_counters;
+    size_t *heap;           /* counter numbers, smallest count first */
+    size_t *index;          /* counter numbers by hash, or NO_COUNTER */
+    unsigned long mask;     /* number of index slots - 1 */
+    arena keys;             /* key buffers */
+};
+
+
+void set_key(space_saving *ss, counter *c, const char *key, size_t len,
+             unsigned long h);
+unsigned long find_slot(space_saving *ss, const char *key, size_t len,
+                        unsigned long h);
+void remove_slot(space_saving *ss, unsigned long i);
+void sift_up(space_saving *ss, size_t i);
+void sift_down_counts(space_saving *ss, size_t i);
+
+
+/*** Utilities. ***/
+
+/* Store a word in a counter, growing its key buffer if needed. */
+void set_key(space_saving *ss, counter *c, const char *key, size_t len,
+             unsigned long h)
+{
+    if (len + 1 > c->size) {
+        c->size = len + 1 > 2 * c->size ? len + 1 : 2 * c->size;
+        c->key = (char *) arena_alloc(&ss->keys, c->size);
+    }
+    memcpy(c->key, key, len);
+    c->key[len] = '\0';
+    c->len = (unsigned int) len;
+    c->hash = h;
+}
+
+
+/*** Index. ***/
+
+/*
+ * Return the index slot that holds the word, or the empty slot where
+ * it would be inserted.  The index is never more than half full, so
+ * an empty slot always ends the probe.
+ */
+unsigned long find_slot(space_saving *ss, const char *key, size_t len,
+                        unsigned long h)
+{
+    unsigned long i;
+    counter *c;
+
+    for (i = h & ss->mask; ss->index[i] != NO_COUNTER;
+         i = (i + 1) & ss->mask) {
+        c = &ss->counters[ss->index[i]];
+        if (c->hash == h && c->len == len && !memcmp(c->key, key, len)) {
+            break;
+        }
+    }
+    return i;
+}
+
+
+/*
+ * Empty an index slot.  Later words of the same probe run are shifted
+ * back into the gap when that keeps them reachable from their home
+ * slot, as in oa_hash_table.c, so no tombstones are needed.
+ */
+void remove_slot(space_saving *ss, unsigned long i)
+{
+    unsigned long j, home;
+
+    j = i;
+    while (1) {
+        j = (j + 1) & ss->mask;
+        if (ss->index[j] == NO_COUNTER) {
+            break;
+        }
+        home = ss->counters[ss->index[j]].hash & ss->mask;
+        if (((j - home) & ss->mask) >= ((j - i) & ss->mask)) {
+            ss->index[i] = ss->index[j];
+            i = j;
+        }
+    }
+    ss->index[i] = NO_COUNTER;
+}
+
+
+/*** Heap. ***/
+
+#define COUNT_AT(ss, i) ((ss)->counters[(ss)->heap[i]].count)
+
+#define PLACE(ss, i, id) \
+    ((ss)->heap[i] = (id), (ss)->counters[id].pos = (i))
+
+/* Move heap[i] up past larger counts. */
+void sift_up(space_saving *ss, size_t i)
+{
+    size_t id, parent;
+
+    id = ss->heap[i];
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (COUNT_AT(ss, parent) <= ss->counters[id].count) {
+            break;
+        }
+        PLACE(ss, i, ss->heap[parent]);
+        i = parent;
+    }
+    PLACE(ss, i, id);
+}
+
+
+/* Move heap[i] down past smaller counts. */
+void sift_down_counts(space_saving *ss, size_t i)
+{
+    size_t id, child;
+
+    id = ss->heap[i];
+    while ((child = 2 * i + 1) < ss->ncounters) {
+        if (child + 1 < ss->ncounters &&
+            COUNT_AT(ss, child + 1) < COUNT_AT(ss, child)) {
+            child++;
+        }
+        if (ss->counters[id].count <= COUNT_AT(ss, child)) {
+            break;
+        }
+        PLACE(ss, i, ss->heap[child]);
+        i = child;
+    }
+    PLACE(ss, i, id);
+}
+
+
+/*** Space Saving utilities. ***/
+
+space_saving *create_space_saving(size_t ncounters)
+{
+    space_saving *ss;
+    unsigned long nslots, i;
+
+    if (ncounters < 1) {
+        ncounters = 1;
+    }
+    nslots = 2;
+    while (nslots < 2 * ncounters) {
+        nslots *= 2;
+    }
+
+    ss = (space_saving *) malloc(sizeof(space_saving));
+    if (ss == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    ss->counters = (counter *) malloc(ncounters * sizeof(counter));
+    ss->heap = (size_t *) malloc(ncounters * sizeof(size_t));
+    ss->index = (size_t *) malloc(nslots * sizeof(size_t));
+    if (ss->counters == NULL || ss->heap == NULL || ss->index == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    ss->ncounters = 0;
+    ss->max_counters = ncounters;
+    ss->mask = nslots - 1;
+    arena_init(&ss->keys);
+
+    for (i = 0; i < ncounters; i++) {
+        ss->counters[i].key = NULL;
+        ss->counters[i].size = 0;
+    }
+    for (i = 0; i < nslots; i++) {
+        ss->index[i] = NO_COUNTER;
+    }
+    return ss;
+}
+
+
+void free_space_saving(space_saving *ss)
+{
+    arena_free(&ss->keys);
+    free(ss->counters);
+    free(ss->heap);
+    free(ss->index);
+    free(ss);
+}
+
+
+void space_saving_add(space_saving *ss, const char *key, size_t len)
+{
+    unsigned long h, i;
+    size_t id;
+    counter *c;
+
+    h = hash_string(key, len);
+    i = find_slot(ss, key, len, h);
+
+    if (ss->index[i] != NO_COUNTER) {
+        /* A tracked word. */
+        c = &ss->counters[ss->index[i]];
+        c->count++;
+        sift_down_counts(ss, c->pos);
+    }
+    else if (ss->ncounters < ss->max_counters) {
+        /* A free counter is left. */
+        id = ss->ncounters++;
+        c = &ss->counters[id];
+        set_key(ss, c, key, len, h);
+        c->count = 1;
+        ss->index[i] = id;
+        PLACE(ss, id, id);
+        sift_up(ss, id);
+    }
+    else {
+        /*
+         * Take over the least counted word's counter.  Removing that
+         * word from the index may shift the slot found above, so look
+         * for the new word's slot again afterwards.
+         */
+        id = ss->heap[0];
+        c = &ss->counters[id];
+        remove_slot(ss, find_slot(ss, c->key, c->len, c->hash));
+        set_key(ss, c, key, len, h);
+        c->count++;
+        ss->index[find_slot(ss, key, len, h)] = id;
+        sift_down_counts(ss, 0);
+    }
+}
+
+
+void top_k_space_saving(space_saving *ss, top_k *heap)
+{
+    size_t i;
+
+    for (i = 0; i < ss->ncounters; i++) {
+        top_k_offer(heap, ss->counters[i].key, ss->counters[i].count);
+    }
+}
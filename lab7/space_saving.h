@@ -0,0 +1,43 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: space_saving.h
+ *
+ *       Declaration of a Space Saving word counter (Metwally, Agrawal
+ *       and El Abbadi, 2005), which finds the most common words of a
+ *       stream in fixed memory.
+ *
+ *       Only M words are tracked at a time.  A word that is not tracked
+ *       when it arrives takes over the counter of the least counted
+ *       word, and inherits its count plus one.  Counts can therefore
+ *       overstate the truth, by at most the count the word inherited,
+ *       but never understate it, and any word that occurs more than N/M
+ *       times in a stream of N words is sure to be tracked at the end.
+ *       If the stream has no more than M distinct words, all counts
+ *       are exact.
+ *
+ */
+
+#ifndef SPACE_SAVING_H
+#define SPACE_SAVING_H
+
+#include <stddef.h>
+#include "top_k.h"
+
+typedef struct _space_saving space_saving;
+
+/* Create a counter that tracks at most 'ncounters' words. */
+space_saving *create_space_saving(size_t ncounters);
+
+void free_space_saving(space_saving *ss);
+
+/* Count one occurrence of the word given as the 'len' bytes at 'key'. */
+void space_saving_add(space_saving *ss, const char *key, size_t len);
+
+/*
+ * Offer every tracked word and its count to a top K heap.  The heap
+ * must be finished with before the counter is changed or freed.
+ */
+void top_k_space_saving(space_saving *ss, top_k *heap);
+
+#endif  /* SPACE_SAVING_H */
@@ -0,0 +1,880 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: swiss_hash_table.c
+ *
+ *       Implementation of the hash table functionality using open
+ *       addressing with group probing, in the style of Google's
+ *       SwissTable.  This engine has the same interface as the engines
+ *       in hash_table.c and oa_hash_table.c.
+ *
+ *       Next to the array of entries the table keeps one control byte
+ *       per slot: 7 bits of the key's hash for a full slot, or a marker
+ *       for an empty or deleted one.  Slots are probed in aligned groups
+ *       of 16.  One SSE2 compare finds every slot of a group whose
+ *       control byte matches the key's 7 bits, so a probe reads 16
+ *       control bytes and, almost always, only the one entry that holds
+ *       the key; another compare tells whether the group has an empty
+ *       slot, which ends the probe.
+ *
+ *       Removed keys leave a "deleted" marker unless their group has an
+ *       empty slot, in which case no probe can have passed through it
+ *       and the slot simply becomes empty.  When the table fills up it
+ *       moves to new arrays, which also drops the markers.  As in
+ *       oa_hash_table.c the old arrays are drained a few groups at a
+ *       time by later insertions, so no single insertion copies the
+ *       whole table.
+ *
+ *       Entries store short keys inline, as in oa_hash_table.c.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "hash_table.h"
+#include "hash_func.h"
+#include "arena.h"
+#include "bloom_filter.h"
+#include "memcheck.h"
+
+/* Slots per group.  Capacities are powers of two of at least GROUP. */
+#define GROUP 16
+
+/* Number of slots in a table created without a capacity hint. */
+#define INITIAL_CAPACITY 128
+
+/* At most 7/8 of the slots may be full or deleted. */
+#define MAX_LOAD_NUM 7
+#define MAX_LOAD_DEN 8
+
+/*
+ * Number of old groups copied into the new arrays by each insertion
+ * while the table grows.  New arrays twice as large take 7/8 of the old
+ * capacity in new keys before they fill up, and new arrays of the same
+ * size (when deleted markers filled the old ones) at least 7/16 of it,
+ * so one group of GROUP slots per insertion drains the old arrays in
+ * time.
+ */
+#define REHASH_STEP 1
+
+/* Control bytes.  A full slot holds H2 of its key, from 0 to 127. */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+#define IS_FULL(c) ((c) < 0x80)
+
+/*
+ * The 7 bits of the hash kept in the control bytes.  The low bits pick
+ * the group and the top HASH_SHARD_BITS may be shared by every key of
+ * a parallel_count() shard, so take the 7 bits just below those.
+ */
+#define H2(h) ((unsigned char) (((h) >> (sizeof(unsigned long) * CHAR_BIT \
+                                        - HASH_SHARD_BITS - 7)) & 0x7f))
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * A single slot of the table; whether it is in use is up to its
+ * control byte.  Keys shorter than INLINE_KEY bytes are stored in the
+ * entry itself and longer ones in the arena.
+ */
+
+#define INLINE_KEY 16
+
+typedef struct
+{
+    unsigned long hash;
+    unsigned int size;              /* key length + 1 */
+    int value;
+    union
+    {
+        char text[INLINE_KEY];      /* a short key and its zero byte */
+        char *ptr;                  /* a long key, in the arena */
+    } key;
+} entry;
+
+#define KEY_LEN(e) ((size_t) (e)->size - 1)
+#define KEY_OF(e) ((e)->size <= INLINE_KEY ? (e)->key.text : (e)->key.ptr)
+
+/*
+ * While the table grows, 'old_ctrl' and 'old_entries' are the arrays
+ * being drained.  Their groups below 'rehash_pos' have already been
+ * copied into the current arrays, and 'growth_left' already allows for
+ * the keys still to come.
+ */
+
+struct _hash_table
+{
+    unsigned char *ctrl;        /* one control byte per slot */
+    entry *entries;
+    unsigned long mask;         /* capacity - 1 */
+    unsigned long count;        /* number of keys in the table */
+    unsigned long growth_left;  /* empty slots that may still be filled */
+    unsigned char *old_ctrl;    /* arrays being drained, or NULL */
+    entry *old_entries;
+    unsigned long old_mask;
+    unsigned long rehash_pos;   /* next old slot to copy across */
+    arena keys;                 /* copies of the long keys */
+    bloom_filter *filter;       /* see hash_table_use_filter(), or NULL */
+};
+
+/* Returned by probe_groups() when the key is not in the table. */
+#define NOT_FOUND ((unsigned long) -1)
+
+
+/*
+ * Function prototypes for the engine's private utilities.
+ */
+
+unsigned int match_byte(const unsigned char *group, unsigned char b);
+unsigned int match_empty(const unsigned char *group);
+unsigned int match_free(const unsigned char *group);
+void alloc_slots(hash_table *ht, unsigned long capacity);
+unsigned long probe_groups(const unsigned char *ctrl, entry *entries,
+                           unsigned long mask, const char *key,
+                           size_t len, unsigned long h,
+                           unsigned long *free_slot);
+entry *find_entry(hash_table *ht, const char *key, size_t len,
+                  unsigned long h, unsigned long *free_slot);
+unsigned long first_empty(hash_table *ht, unsigned long h);
+void rehash_step(hash_table *ht, unsigned long ngroups);
+void grow_table(hash_table *ht, unsigned long capacity);
+entry *add_entry(hash_table *ht, const char *key, size_t len,
+                 unsigned long h, int value, unsigned long slot);
+void add_group_lengths(hash_stats *stats, const unsigned char *ctrl,
+                       entry *entries, unsigned long mask,
+                       unsigned long start);
+void filter_insert(hash_table *ht, unsigned long h);
+void refill_filter(hash_table *ht);
+
+
+/*** Group utilities. ***/
+
+/*
+ * Each returns a 16 bit mask with bit i set if byte i of the group
+ * passes the test: equal to 'b', empty, or empty or deleted (the only
+ * bytes with the high bit set).
+ */
+
+#ifdef __SSE2__
+
+#define LOAD_GROUP(g) _mm_loadu_si128((const __m128i *) (g))
+
+unsigned int match_byte(const unsigned char *group, unsigned char b)
+{
+    return (unsigned int) _mm_movemask_epi8(
+        _mm_cmpeq_epi8(LOAD_GROUP(group), _mm_set1_epi8((char) b)));
+}
+
+
+unsigned int match_empty(const unsigned char *group)
+{
+    return match_byte(group, CTRL_EMPTY);
+}
+
+
+unsigned int match_free(const unsigned char *group)
+{
+    return (unsigned int) _mm_movemask_epi8(LOAD_GROUP(group));
+}
+
+#else
+
+unsigned int match_byte(const unsigned char *group, unsigned char b)
+{
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i = 0; i < GROUP; i++) {
+        mask |= (unsigned int) (group[i] == b) << i;
+    }
+    return mask;
+}
+
+
+unsigned int match_empty(const unsigned char *group)
+{
+    return match_byte(group, CTRL_EMPTY);
+}
+
+
+unsigned int match_free(const unsigned char *group)
+{
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i = 0; i < GROUP; i++) {
+        mask |= (unsigned int) !IS_FULL(group[i]) << i;
+    }
+    return mask;
+}
+
+#endif
+
+
+/*** Slot array utilities. ***/
+
+/* Give the table 'capacity' empty slots. */
+void alloc_slots(hash_table *ht, unsigned long capacity)
+{
+    ht->ctrl = (unsigned char *) malloc(capacity);
+    ht->entries = (entry *) malloc(capacity * sizeof(entry));
+    if (ht->ctrl == NULL || ht->entries == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    memset(ht->ctrl, CTRL_EMPTY, capacity);
+    ht->mask = capacity - 1;
+    ht->growth_left = capacity * MAX_LOAD_NUM / MAX_LOAD_DEN - ht->count;
+}
+
+
+/*
+ * Return the slot of the arrays 'ctrl' and 'entries' holding the 'len'
+ * bytes at 'key' (whose hash is 'h'), or NOT_FOUND.  In that case set
+ * 'free_slot' to the first empty or deleted slot on the key's probe
+ * path, where it would be inserted.  Groups are probed in order,
+ * starting with the one that holds slot h & mask, until a group with
+ * an empty slot.
+ */
+unsigned long probe_groups(const unsigned char *ctrl, entry *entries,
+                           unsigned long mask, const char *key,
+                           size_t len, unsigned long h,
+                           unsigned long *free_slot)
+{
+    const unsigned char *group;
+    unsigned long pos, i;
+    unsigned int match, free_mask;
+    unsigned char h2;
+    int have_free;
+    entry *e;
+
+    h2 = H2(h);
+    have_free = 0;
+    pos = h & mask & ~(unsigned long) (GROUP - 1);
+    while (1) {
+        group = ctrl + pos;
+
+        for (match = match_byte(group, h2); match != 0;
+             match &= match - 1) {
+            i = pos + __builtin_ctz(match);
+            e = &entries[i];
+            if (e->hash == h && e->size == len + 1 &&
+                !memcmp(KEY_OF(e), key, len)) {
+                return i;
+            }
+        }
+
+        if (!have_free && (free_mask = match_free(group)) != 0) {
+            *free_slot = pos + __builtin_ctz(free_mask);
+            have_free = 1;
+        }
+        if (match_empty(group) != 0) {
+            return NOT_FOUND;
+        }
+        pos = (pos + GROUP) & mask;
+    }
+}
+
+
+/*
+ * Return the entry holding 'key', or NULL if the key is not in the
+ * table, and set 'free_slot' to the slot of the current arrays where
+ * it would be inserted.  While the table grows, keys that have not
+ * been copied across yet are found in the old arrays.
+ */
+entry *find_entry(hash_table *ht, const char *key, size_t len,
+                  unsigned long h, unsigned long *free_slot)
+{
+    unsigned long i, old_free;
+
+    i = probe_groups(ht->ctrl, ht->entries, ht->mask, key, len, h,
+                     free_slot);
+    if (i != NOT_FOUND) {
+        return &ht->entries[i];
+    }
+    if (ht->old_ctrl != NULL) {
+        i = probe_groups(ht->old_ctrl, ht->old_entries, ht->old_mask,
+                         key, len, h, &old_free);
+        if (i != NOT_FOUND && i >= ht->rehash_pos) {
+            return &ht->old_entries[i];
+        }
+    }
+    return NULL;
+}
+
+
+/* Return the first empty slot on the probe path of hash 'h'. */
+unsigned long first_empty(hash_table *ht, unsigned long h)
+{
+    unsigned long pos;
+    unsigned int empty;
+
+    pos = h & ht->mask & ~(unsigned long) (GROUP - 1);
+    while ((empty = match_empty(ht->ctrl + pos)) == 0) {
+        pos = (pos + GROUP) & ht->mask;
+    }
+    return pos + __builtin_ctz(empty);
+}
+
+
+/*
+ * Copy up to 'ngroups' groups of the old arrays into the current ones,
+ * and release the old arrays once they have been drained.  Keys in the
+ * old arrays are never in the current ones, so each copy just takes the
+ * first empty slot of its probe path, and the cached hashes are reused.
+ * Deleted slots are not copied.
+ */
+void rehash_step(hash_table *ht, unsigned long ngroups)
+{
+    unsigned long i, j;
+
+    while (ht->old_ctrl != NULL && ngroups-- > 0) {
+        for (i = ht->rehash_pos; i < ht->rehash_pos + GROUP; i++) {
+            if (IS_FULL(ht->old_ctrl[i])) {
+                j = first_empty(ht, ht->old_entries[i].hash);
+                ht->ctrl[j] = ht->old_ctrl[i];
+                ht->entries[j] = ht->old_entries[i];
+            }
+        }
+
+        ht->rehash_pos += GROUP;
+        if (ht->rehash_pos > ht->old_mask) {
+            free(ht->old_ctrl);
+            free(ht->old_entries);
+            ht->old_ctrl = NULL;
+            ht->old_entries = NULL;
+        }
+    }
+}
+
+
+/*
+ * Start moving the table to new arrays of 'capacity' slots: the
+ * current arrays become the old ones.  A previous move that has not
+ * finished yet is completed first.
+ */
+void grow_table(hash_table *ht, unsigned long capacity)
+{
+    if (ht->old_ctrl != NULL) {
+        rehash_step(ht, (ht->old_mask + 1) / GROUP);
+    }
+
+    ht->old_ctrl = ht->ctrl;
+    ht->old_entries = ht->entries;
+    ht->old_mask = ht->mask;
+    ht->rehash_pos = 0;
+    alloc_slots(ht, capacity);
+}
+
+
+/*
+ * Store a new key in 'slot', the free slot returned by find_entry().
+ * Filling an empty slot uses up growth; when there is none left the
+ * table moves to new arrays first, twice as large unless deleted slots
+ * were what used it up, and the key goes to a slot of the new arrays.
+ */
+entry *add_entry(hash_table *ht, const char *key, size_t len,
+                 unsigned long h, int value, unsigned long slot)
+{
+    unsigned long capacity;
+    entry *e;
+
+    if (ht->ctrl[slot] == CTRL_EMPTY && ht->growth_left == 0) {
+        capacity = ht->mask + 1;
+        if ((ht->count + 1) * MAX_LOAD_DEN * 2 >
+            capacity * MAX_LOAD_NUM) {
+            capacity *= 2;
+        }
+        grow_table(ht, capacity);
+        slot = first_empty(ht, h);
+    }
+    if (ht->ctrl[slot] == CTRL_EMPTY) {
+        ht->growth_left--;
+    }
+
+    ht->ctrl[slot] = H2(h);
+    e = &ht->entries[slot];
+    e->hash = h;
+    e->size = (unsigned int) len + 1;
+    if (len < INLINE_KEY) {
+        memcpy(e->key.text, key, len);
+        e->key.text[len] = '\0';
+    }
+    else {
+        e->key.ptr = arena_strdup(&ht->keys, key, len);
+    }
+    e->value = value;
+    ht->count++;
+    filter_insert(ht, h);
+    return e;
+}
+
+
+/*** Hash table utilities. ***/
+
+/* Create a new hash table. */
+hash_table *create_hash_table()
+{
+    return create_hash_table_sized(INITIAL_CAPACITY * MAX_LOAD_NUM
+                                   / MAX_LOAD_DEN);
+}
+
+
+/*
+ * Create a hash table sized for about 'capacity_hint' keys, so that
+ * tables whose final size is known up front never have to grow.
+ */
+hash_table *create_hash_table_sized(unsigned long capacity_hint)
+{
+    unsigned long capacity;
+    hash_table *ht;
+
+    ht = (hash_table *) malloc(sizeof(hash_table));
+    if (ht == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    capacity = GROUP;
+    while (capacity * MAX_LOAD_NUM / MAX_LOAD_DEN < capacity_hint) {
+        capacity *= 2;
+    }
+    ht->count = 0;
+    alloc_slots(ht, capacity);
+    ht->old_ctrl = NULL;
+    ht->old_entries = NULL;
+    ht->old_mask = 0;
+    ht->rehash_pos = 0;
+    arena_init(&ht->keys);
+    ht->filter = NULL;
+    return ht;
+}
+
+
+/* Free a hash table. */
+void free_hash_table(hash_table *ht)
+{
+    free(ht->ctrl);
+    free(ht->entries);
+    if (ht->old_ctrl != NULL) {
+        free(ht->old_ctrl);
+        free(ht->old_entries);
+    }
+    arena_free(&ht->keys);
+    if (ht->filter != NULL) {
+        free_bloom_filter(ht->filter);
+    }
+    free(ht);
+}
+
+
+/*
+ * Look for a key in the hash table.  Return 0 if not found.
+ * If it is found return the associated value.
+ */
+int get_value(hash_table *ht, char *key)
+{
+    unsigned long h, free_slot;
+    size_t len;
+    entry *e;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    e = find_entry(ht, key, len, h, &free_slot);
+    if (e == NULL) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
+        }
+        return 0;
+    }
+    return e->value;
+}
+
+
+/*
+ * Set the value stored at a key.  If the key is not in the table,
+ * create a new entry and set the value to 'value'.  The table stores
+ * its own copy of 'key'.
+ */
+void set_value(hash_table *ht, char *key, int value)
+{
+    unsigned long h, free_slot;
+    size_t len;
+    entry *e;
+
+    rehash_step(ht, REHASH_STEP);
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    e = find_entry(ht, key, len, h, &free_slot);
+    if (e != NULL) {
+        e->value = value;
+    }
+    else {
+        add_entry(ht, key, len, h, value, free_slot);
+    }
+}
+
+
+/*
+ * Return a pointer to the value stored at a key, inserting the key
+ * with a value of 0 if it is not in the table yet.  The pointer is
+ * valid until the table is next modified.
+ */
+int *find_or_insert(hash_table *ht, char *key)
+{
+    return find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as find_or_insert, for a key given as 'len' bytes that need
+ * not be zero terminated.
+ */
+int *find_or_insert_n(hash_table *ht, const char *key, size_t len)
+{
+    return find_or_insert_hashed(ht, key, len, hash_string(key, len));
+}
+
+
+/*
+ * The same as find_or_insert_n, for a key whose hash_string() value
+ * 'h' the caller has already computed.
+ */
+int *find_or_insert_hashed(hash_table *ht, const char *key, size_t len,
+                           unsigned long h)
+{
+    unsigned long free_slot;
+    entry *e;
+
+    rehash_step(ht, REHASH_STEP);
+
+    e = find_entry(ht, key, len, h, &free_slot);
+    if (e == NULL) {
+        e = add_entry(ht, key, len, h, 0, free_slot);
+    }
+    return &e->value;
+}
+
+
+/*
+ * Add one to the value stored at a key, inserting the key with a value
+ * of 1 if it is not in the table yet.  Return the new value.
+ */
+int increment(hash_table *ht, char *key)
+{
+    return ++*find_or_insert_n(ht, key, strlen(key));
+}
+
+
+/*
+ * The same as increment, for a key given as 'len' bytes that need not
+ * be zero terminated.
+ */
+int increment_n(hash_table *ht, const char *key, size_t len)
+{
+    return ++*find_or_insert_n(ht, key, len);
+}
+
+
+/*
+ * Remove a key from the hash table.  Return 1 if the key was found and
+ * removed, otherwise 0.  A long key's copy is reclaimed only when the
+ * table is freed.  Removal is rare, so a pending move to new arrays is
+ * simply finished first, as in oa_hash_table.c.
+ */
+int remove_key(hash_table *ht, char *key)
+{
+    unsigned long h, i, free_slot;
+    size_t len;
+
+    len = strlen(key);
+    h = hash_string(key, len);
+    if (ht->filter != NULL && !bloom_check(ht->filter, h)) {
+        return 0;
+    }
+    if (ht->old_ctrl != NULL) {
+        rehash_step(ht, (ht->old_mask + 1) / GROUP);
+    }
+    i = probe_groups(ht->ctrl, ht->entries, ht->mask, key, len, h,
+                     &free_slot);
+    if (i == NOT_FOUND) {
+        if (ht->filter != NULL) {
+            ht->filter->false_positives++;
+        }
+        return 0;
+    }
+
+    if (match_empty(ht->ctrl + (i & ~(unsigned long) (GROUP - 1))) != 0) {
+        ht->ctrl[i] = CTRL_EMPTY;
+        ht->growth_left++;
+    }
+    else {
+        ht->ctrl[i] = CTRL_DELETED;
+    }
+    ht->count--;
+    return 1;
+}
+
+
+/*
+ * Add the value of every key of 'src' to the value of the same key in
+ * 'dst', inserting keys that 'dst' does not have yet.  'src' is not
+ * changed.  The cached hashes are reused, so no key is hashed again.
+ */
+void merge_hash_tables(hash_table *dst, hash_table *src)
+{
+    unsigned long i;
+    entry *e;
+
+    if (src->old_ctrl != NULL) {
+        for (i = src->rehash_pos; i <= src->old_mask; i++) {
+            if (IS_FULL(src->old_ctrl[i])) {
+                e = &src->old_entries[i];
+                *find_or_insert_hashed(dst, KEY_OF(e), KEY_LEN(e),
+                                       e->hash) += e->value;
+            }
+        }
+    }
+    for (i = 0; i <= src->mask; i++) {
+        if (IS_FULL(src->ctrl[i])) {
+            e = &src->entries[i];
+            *find_or_insert_hashed(dst, KEY_OF(e), KEY_LEN(e), e->hash) +=
+                e->value;
+        }
+    }
+}
+
+
+/* Offer every key of the hash table and its value to a top K heap. */
+void top_k_hash_table(hash_table *ht, top_k *heap)
+{
+    unsigned long i;
+
+    if (ht->old_ctrl != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            if (IS_FULL(ht->old_ctrl[i])) {
+                top_k_offer(heap, KEY_OF(&ht->old_entries[i]),
+                            ht->old_entries[i].value);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        if (IS_FULL(ht->ctrl[i])) {
+            top_k_offer(heap, KEY_OF(&ht->entries[i]),
+                        ht->entries[i].value);
+        }
+    }
+}
+
+
+/* Return the number of keys in the hash table. */
+unsigned long hash_table_size(hash_table *ht)
+{
+    return ht->count;
+}
+
+
+/*
+ * Store every key and its value in 'out'.  Short keys point into the
+ * entries, so they are only valid until the table is next modified.
+ */
+unsigned long collect_hash_table(hash_table *ht, word_count *out)
+{
+    unsigned long i, n;
+
+    n = 0;
+    if (ht->old_ctrl != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            if (IS_FULL(ht->old_ctrl[i])) {
+                out[n].key = KEY_OF(&ht->old_entries[i]);
+                out[n++].value = ht->old_entries[i].value;
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        if (IS_FULL(ht->ctrl[i])) {
+            out[n].key = KEY_OF(&ht->entries[i]);
+            out[n++].value = ht->entries[i].value;
+        }
+    }
+    return n;
+}
+
+
+/* Print out the contents of the hash table as key/value pairs. */
+void print_hash_table(hash_table *ht)
+{
+    unsigned long i;
+
+    if (ht->old_ctrl != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            if (IS_FULL(ht->old_ctrl[i])) {
+                printf("%s %d\n", KEY_OF(&ht->old_entries[i]),
+                       ht->old_entries[i].value);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        if (IS_FULL(ht->ctrl[i])) {
+            printf("%s %d\n", KEY_OF(&ht->entries[i]),
+                   ht->entries[i].value);
+        }
+    }
+}
+
+
+/*** Iteration and statistics. ***/
+
+/*
+ * The cursor's 'pos' counts the slots already looked at: those of the
+ * old arrays from 'rehash_pos' on, then those of the current ones.
+ */
+void hash_table_begin(hash_table_cursor *c)
+{
+    c->pos = 0;
+    c->link = NULL;
+}
+
+
+int hash_table_next(hash_table *ht, hash_table_cursor *c,
+                    const char **key, int **value)
+{
+    unsigned long nold, i;
+
+    nold = (ht->old_ctrl != NULL) ? ht->old_mask + 1 - ht->rehash_pos : 0;
+    while (c->pos < nold + ht->mask + 1) {
+        i = c->pos++;
+        if (i < nold) {
+            i += ht->rehash_pos;
+            if (IS_FULL(ht->old_ctrl[i])) {
+                *key = KEY_OF(&ht->old_entries[i]);
+                *value = &ht->old_entries[i].value;
+                return 1;
+            }
+        }
+        else if (IS_FULL(ht->ctrl[i - nold])) {
+            *key = KEY_OF(&ht->entries[i - nold]);
+            *value = &ht->entries[i - nold].value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Add the probe length, in groups, of each key in slots 'start' to
+ * 'mask' of the arrays to the histogram.  A key's probe starts at the
+ * group holding its home slot and ends at the group it is in, so its
+ * length is the number of groups between them, plus one.
+ */
+void add_group_lengths(hash_stats *stats, const unsigned char *ctrl,
+                       entry *entries, unsigned long mask,
+                       unsigned long start)
+{
+    unsigned long i, home, len;
+
+    for (i = start; i <= mask; i++) {
+        if (!IS_FULL(ctrl[i])) {
+            continue;
+        }
+        home = entries[i].hash & ~(unsigned long) (GROUP - 1);
+        len = ((i - home) & mask) / GROUP + 1;
+        stats->histogram[len < HASH_STATS_LENGTHS ? len
+                                                  : HASH_STATS_LENGTHS - 1]++;
+        if (len > stats->max_length) {
+            stats->max_length = len;
+        }
+        stats->mean_length += len;
+    }
+}
+
+
+void hash_table_stats(hash_table *ht, hash_stats *stats)
+{
+    memset(stats, 0, sizeof(hash_stats));
+    stats->keys = ht->count;
+    stats->slots = ht->mask + 1;
+    if (ht->old_ctrl != NULL) {
+        stats->slots += ht->old_mask + 1 - ht->rehash_pos;
+        add_group_lengths(stats, ht->old_ctrl, ht->old_entries,
+                          ht->old_mask, ht->rehash_pos);
+    }
+    add_group_lengths(stats, ht->ctrl, ht->entries, ht->mask, 0);
+
+    stats->load_factor = (double) stats->keys / stats->slots;
+    if (stats->keys > 0) {
+        stats->mean_length /= stats->keys;
+    }
+    if (ht->filter != NULL) {
+        stats->filter_checks = ht->filter->checks;
+        stats->filter_rejects = ht->filter->rejects;
+        stats->filter_false_positives = ht->filter->false_positives;
+    }
+}
+
+/*** Negative lookup filter. ***/
+
+/*
+ * Add a new key's hash to the filter, if the table has one.  Once the
+ * keys outgrow the filter it is rebuilt twice as large, which also
+ * drops the keys removed since it was last built.
+ */
+void filter_insert(hash_table *ht, unsigned long h)
+{
+    if (ht->filter == NULL) {
+        return;
+    }
+    if (ht->count <= ht->filter->capacity) {
+        bloom_add(ht->filter, h);
+    }
+    else {
+        clear_bloom_filter(ht->filter, 2 * ht->filter->capacity);
+        refill_filter(ht);
+    }
+}
+
+
+/* Add every key of the table to its filter, from the cached hashes. */
+void refill_filter(hash_table *ht)
+{
+    unsigned long i;
+
+    if (ht->old_ctrl != NULL) {
+        for (i = ht->rehash_pos; i <= ht->old_mask; i++) {
+            if (IS_FULL(ht->old_ctrl[i])) {
+                bloom_add(ht->filter, ht->old_entries[i].hash);
+            }
+        }
+    }
+    for (i = 0; i <= ht->mask; i++) {
+        if (IS_FULL(ht->ctrl[i])) {
+            bloom_add(ht->filter, ht->entries[i].hash);
+        }
+    }
+}
+
+
+void hash_table_use_filter(hash_table *ht)
+{
+    if (ht->filter == NULL) {
+        ht->filter = create_bloom_filter(2 * ht->count + INITIAL_CAPACITY);
+        refill_filter(ht);
+    }
+}
@@ -0,0 +1,280 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: test_concurrent.c
+ *
+ *       Stress test and scaling benchmark for the concurrent word count
+ *       table, run against each of its synchronization schemes.
+ *
+ *       The stress test has several writer threads add to a shared set
+ *       of keys while a reader thread checks that no count it sees ever
+ *       goes down or past its final value; afterwards every count must
+ *       be exact.  The benchmark (-b) times a skewed stream of adds with
+ *       1, 2, 4, ... threads and reports the throughput of each scheme.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "concurrent_table.h"
+#include "memcheck.h"
+
+/* Distinct keys and rounds over them in the stress test. */
+#define NKEYS 2000
+#define ROUNDS 200
+
+/* Adds done by each thread in the benchmark. */
+#define BENCH_OPS 1000000
+
+/* Most threads either test starts. */
+#define MAX_THREADS 64
+
+#define KEY_SIZE 16
+
+
+/* The work of one thread. */
+typedef struct
+{
+    int id;
+    int nthreads;
+    concurrent_table *ct;
+    char (*keys)[KEY_SIZE];
+    int *done;              /* set once all writers have finished */
+    int errors;             /* problems found by this thread */
+} worker;
+
+
+static char *mode_names[] = { "global lock", "striped", "lock free" };
+
+
+void *write_keys(void *arg);
+void *read_keys(void *arg);
+void *bench_keys(void *arg);
+int stress(int mode, int nthreads, char (*keys)[KEY_SIZE]);
+double bench(int mode, int nthreads, char (*keys)[KEY_SIZE]);
+double now(void);
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [-b] [nthreads]\n", progname);
+}
+
+
+/* Wall clock time in seconds. */
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/* Add 1 to every key ROUNDS times, each thread from its own offset. */
+void *write_keys(void *arg)
+{
+    worker *w = (worker *) arg;
+    int r, i;
+
+    for (r = 0; r < ROUNDS; r++) {
+        for (i = 0; i < NKEYS; i++) {
+            cht_add(w->ct, w->keys[(i + w->id * 97) % NKEYS], 1);
+        }
+    }
+    return NULL;
+}
+
+
+/* Check that counts only grow, until the writers are done. */
+void *read_keys(void *arg)
+{
+    worker *w = (worker *) arg;
+    int *seen;
+    int i, value, max;
+
+    seen = (int *) calloc(NKEYS, sizeof(int));
+    if (seen == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    max = w->nthreads * ROUNDS;
+
+    while (!__atomic_load_n(w->done, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < NKEYS; i++) {
+            value = cht_get(w->ct, w->keys[i]);
+            if (value < seen[i] || value > max) {
+                fprintf(stderr, "read %d at \"%s\" after %d\n",
+                        value, w->keys[i], seen[i]);
+                w->errors++;
+            }
+            seen[i] = value;
+        }
+    }
+    free(seen);
+    return NULL;
+}
+
+
+/* Add 1 to keys drawn from a skewed distribution, as in real text. */
+void *bench_keys(void *arg)
+{
+    worker *w = (worker *) arg;
+    unsigned long state;
+    double u;
+    int i;
+
+    state = 12345 + w->id;
+    for (i = 0; i < BENCH_OPS; i++) {
+        state = state * 1103515245UL + 12345UL;
+        u = ((state >> 8) & 0xffffff) / (double) 0x1000000;
+        cht_add(w->ct, w->keys[(int) (NKEYS * u * u * u)], 1);
+    }
+    return NULL;
+}
+
+
+/* Run the stress test on one scheme; return the number of errors. */
+int stress(int mode, int nthreads, char (*keys)[KEY_SIZE])
+{
+    pthread_t threads[MAX_THREADS + 1];
+    worker workers[MAX_THREADS + 1];
+    concurrent_table *ct;
+    int done, errors, i;
+
+    ct = cht_create(mode, NKEYS);
+    done = 0;
+    for (i = 0; i <= nthreads; i++) {
+        workers[i].id = i;
+        workers[i].nthreads = nthreads;
+        workers[i].ct = ct;
+        workers[i].keys = keys;
+        workers[i].done = &done;
+        workers[i].errors = 0;
+    }
+
+    /* Workers 0 .. nthreads - 1 write; the last one reads. */
+    pthread_create(&threads[nthreads], NULL, read_keys, &workers[nthreads]);
+    for (i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, write_keys, &workers[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    pthread_join(threads[nthreads], NULL);
+
+    errors = workers[nthreads].errors;
+    for (i = 0; i < NKEYS; i++) {
+        if (cht_get(ct, keys[i]) != nthreads * ROUNDS) {
+            fprintf(stderr, "%s: final count %d at \"%s\", expected %d\n",
+                    mode_names[mode], cht_get(ct, keys[i]), keys[i],
+                    nthreads * ROUNDS);
+            errors++;
+        }
+    }
+
+    cht_free(ct);
+    return errors;
+}
+
+
+/* Time the benchmark on one scheme; return adds per second. */
+double bench(int mode, int nthreads, char (*keys)[KEY_SIZE])
+{
+    pthread_t threads[MAX_THREADS];
+    worker workers[MAX_THREADS];
+    concurrent_table *ct;
+    double start, elapsed;
+    int i;
+
+    ct = cht_create(mode, NKEYS);
+    for (i = 0; i < nthreads; i++) {
+        workers[i].id = i;
+        workers[i].nthreads = nthreads;
+        workers[i].ct = ct;
+        workers[i].keys = keys;
+    }
+
+    start = now();
+    for (i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, bench_keys, &workers[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = now() - start;
+
+    cht_free(ct);
+    return (double) nthreads * BENCH_OPS / elapsed;
+}
+
+
+int main(int argc, char **argv)
+{
+    char (*keys)[KEY_SIZE];
+    int benchmark, nthreads, mode, n, errors, i;
+
+    benchmark = 0;
+    nthreads = 4;
+    i = 1;
+    if (i < argc && strcmp(argv[i], "-b") == 0) {
+        benchmark = 1;
+        i++;
+    }
+    if (i < argc) {
+        nthreads = atoi(argv[i++]);
+    }
+    if (i < argc || nthreads < 1 || nthreads > MAX_THREADS) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    keys = (char (*)[KEY_SIZE]) calloc(NKEYS, KEY_SIZE);
+    if (keys == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    for (i = 0; i < NKEYS; i++) {
+        sprintf(keys[i], "key%d", i);
+    }
+
+    errors = 0;
+    if (benchmark) {
+        printf("%-8s %14s %14s %14s\n", "threads", mode_names[0],
+               mode_names[1], mode_names[2]);
+        for (n = 1; n <= nthreads; n *= 2) {
+            printf("%-8d", n);
+            for (mode = CHT_GLOBAL_LOCK; mode <= CHT_LOCK_FREE; mode++) {
+                printf(" %10.2f M/s", bench(mode, n, keys) / 1e6);
+                fflush(stdout);
+            }
+            printf("\n");
+        }
+    }
+    else {
+        for (mode = CHT_GLOBAL_LOCK; mode <= CHT_LOCK_FREE; mode++) {
+            n = stress(mode, nthreads, keys);
+            if (n != 0) {
+                printf("Test failed! (test_concurrent %s)\n",
+                       mode_names[mode]);
+            }
+            else {
+                printf("Test succeeded! (test_concurrent %s)\n",
+                       mode_names[mode]);
+            }
+            errors += n;
+        }
+    }
+
+    free(keys);
+    print_memory_leaks();
+    return errors != 0;
+}
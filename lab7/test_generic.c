@@ -0,0 +1,229 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: test_generic.c
+ *
+ *       Tests of the generic hash table (generic_table.h).
+ *
+ *       With a filename, count the words of the file in a word_counts
+ *       table and print them, for run_test to compare with the other
+ *       engines.  Without one, check 64 bit counts, integer keys, and a
+ *       table with struct values defined right here, through growth,
+ *       removal and iteration.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typed_tables.h"
+#include "tokenizer.h"
+#include "hash_func.h"
+#include "memcheck.h"
+
+/* Keys used by the integer key tests. */
+#define NIDS 100000
+
+/* A table with struct values, private to this program. */
+typedef struct
+{
+    long x;
+    long y;
+} point;
+
+#define ID_EQUAL(a, b) ((a) == (b))
+
+GENERIC_TABLE_DECLARE(point_table, unsigned long, point)
+GENERIC_TABLE_DEFINE(point_table, unsigned long, point, hash_ulong,
+                     ID_EQUAL, GT_NO_COPY)
+
+
+void count_words(char *filename);
+int test_big_counts(void);
+int test_id_counts(void);
+int test_points(void);
+void report(char *name, int errors);
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [filename]\n", progname);
+}
+
+
+/* Count and print the words of a file. */
+void count_words(char *filename)
+{
+    word_counts *t;
+    tokenizer input;
+    const char *word;
+    char *buf;
+    size_t len, size;
+    unsigned long pos;
+    count64 *count;
+
+    if (tokenizer_open(&input, filename) != 0) {
+        fprintf(stderr, "Input file \"%s\" does not exist! "
+                "Terminating program.\n", filename);
+        exit(1);
+    }
+
+    /* Keys must be zero terminated, so words pass through a buffer. */
+    t = word_counts_create(0);
+    size = 0;
+    buf = NULL;
+    while (next_word(&input, &word, &len)) {
+        if (len + 1 > size) {
+            if (buf != NULL) {
+                free(buf);
+            }
+            size = 2 * (len + 1);
+            buf = (char *) malloc(size);
+            if (buf == NULL) {
+                fprintf(stderr, "Fatal error: out of memory. "
+                        "Terminating program.\n");
+                exit(1);
+            }
+        }
+        memcpy(buf, word, len);
+        buf[len] = '\0';
+        ++*word_counts_find_or_insert(t, buf);
+    }
+
+    pos = 0;
+    while (word_counts_next(t, &pos, &word, &count)) {
+        printf("%s %lu\n", word, (unsigned long) *count);
+    }
+
+    if (buf != NULL) {
+        free(buf);
+    }
+    word_counts_free(t);
+    tokenizer_close(&input);
+}
+
+
+/* Counts past 2^32 must not wrap. */
+int test_big_counts(void)
+{
+    word_counts *t;
+    count64 *c;
+    int errors;
+
+    t = word_counts_create(0);
+    *word_counts_find_or_insert(t, "big") += 3000000000UL;
+    *word_counts_find_or_insert(t, "big") += 3000000000UL;
+    c = word_counts_find(t, "big");
+    errors = (c == NULL || *c / 1000 != 6000000UL || *c % 1000 != 0);
+    errors += word_counts_find(t, "small") != NULL;
+    word_counts_free(t);
+    return errors;
+}
+
+
+/* Insert, remove every other key, and check what is left. */
+int test_id_counts(void)
+{
+    id_counts *t;
+    unsigned long i, pos, key;
+    count64 *c;
+    int errors;
+
+    errors = 0;
+    t = id_counts_create(0);
+    for (i = 0; i < NIDS; i++) {
+        *id_counts_find_or_insert(t, i << 20) = i;
+    }
+    for (i = 0; i < NIDS; i += 2) {
+        errors += !id_counts_remove(t, i << 20);
+    }
+    errors += id_counts_remove(t, 0);
+    errors += id_counts_size(t) != NIDS / 2;
+
+    for (i = 0; i < NIDS; i++) {
+        c = id_counts_find(t, i << 20);
+        if (i % 2 == 0) {
+            errors += c != NULL;
+        }
+        else {
+            errors += c == NULL || *c != i;
+        }
+    }
+
+    pos = 0;
+    i = 0;
+    while (id_counts_next(t, &pos, &key, &c)) {
+        errors += *c != key >> 20;
+        i++;
+    }
+    errors += i != NIDS / 2;
+
+    id_counts_free(t);
+    return errors;
+}
+
+
+/* Struct values are stored in the slots and start out zeroed. */
+int test_points(void)
+{
+    point_table *t;
+    point *p;
+    unsigned long i;
+    int errors;
+
+    errors = 0;
+    t = point_table_create(NIDS);
+    for (i = 0; i < NIDS; i++) {
+        p = point_table_find_or_insert(t, i);
+        errors += p->x != 0 || p->y != 0;
+        p->x = (long) i;
+        p->y = -(long) i;
+    }
+    for (i = 0; i < NIDS; i++) {
+        p = point_table_find(t, i);
+        errors += p == NULL || p->x != (long) i || p->y != -(long) i;
+    }
+    point_table_free(t);
+    return errors;
+}
+
+
+void report(char *name, int errors)
+{
+    if (errors != 0) {
+        printf("Test failed! (test_generic %s)\n", name);
+    }
+    else {
+        printf("Test succeeded! (test_generic %s)\n", name);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    int errors, n;
+
+    if (argc > 2) {
+        usage(argv[0]);
+        exit(1);
+    }
+    if (argc == 2) {
+        count_words(argv[1]);
+        print_memory_leaks();
+        return 0;
+    }
+
+    errors = 0;
+    n = test_big_counts();
+    report("64 bit counts", n);
+    errors += n;
+    n = test_id_counts();
+    report("integer keys", n);
+    errors += n;
+    n = test_points();
+    report("struct values", n);
+    errors += n;
+
+    print_memory_leaks();
+    return errors != 0;
+}
@@ -0,0 +1,549 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: tokenizer.c
+ *
+ *       Implementation of the zero copy word tokenizer.  Word
+ *       boundaries are found 16 bytes at a time with SSE2 where it is
+ *       available, and a byte at a time otherwise.
+ *
+ *       Normalized words are lower cased 16 bytes at a time as they are
+ *       copied out of the input, by the same loop that looks for their
+ *       end, so each byte is read once.  Only a word with bytes above
+ *       127 takes a second, byte at a time pass to validate and fold its
+ *       UTF8.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tokenizer.h"
+#include "memcheck.h"
+
+/* Size of the reads used for input that cannot be mapped. */
+#define READ_SIZE 65536
+
+/* Space, or one of \t \n \v \f \r (9 to 13). */
+#define IS_SPACE(c) ((c) == ' ' || (unsigned char) ((c) - '\t') <= 4)
+
+/* ASCII capitals, and ASCII punctuation: ! to /, : to @, [ to `, { to ~. */
+#define IS_UPPER(c) ((unsigned char) ((c) - 'A') <= 'Z' - 'A')
+#define IS_PUNCT(c) ((unsigned char) ((c) - '!') <= '/' - '!' || \
+                     (unsigned char) ((c) - ':') <= '@' - ':' || \
+                     (unsigned char) ((c) - '[') <= '`' - '[' || \
+                     (unsigned char) ((c) - '{') <= '~' - '{')
+
+/* The replacement character, 0xFFFD, in UTF8. */
+#define REPLACEMENT "\357\277\275"
+
+
+const char *skip_space(const char *p, const char *end);
+const char *find_space(const char *p, const char *end);
+int read_all(tokenizer *t, int fd);
+void reserve_word(tokenizer *t, size_t size, size_t keep);
+const char *copy_lower(tokenizer *t, const char *p, const char *end,
+                       size_t *n, int *high);
+unsigned long fold_code_point(unsigned long c);
+size_t fold_utf8(char *out, const unsigned char *p,
+                 const unsigned char *end);
+size_t leading_punct(const unsigned char *w, size_t n);
+size_t trailing_punct(const unsigned char *w, size_t n);
+int next_normalized_word(tokenizer *t, const char **word, size_t *len);
+
+
+#ifdef __SSE2__
+
+/*
+ * Return a 16 bit mask with bit i set if byte i of 'v' is whitespace.
+ * The range test uses a saturating subtract: (c - 9) <= 4 as an
+ * unsigned byte exactly when (c - 9) minus 4, clamped at zero, is zero.
+ */
+#define SPACE_BITS(v) \
+    _mm_movemask_epi8(_mm_or_si128( \
+        _mm_cmpeq_epi8((v), _mm_set1_epi8(' ')), \
+        _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8((v), \
+            _mm_set1_epi8('\t')), _mm_set1_epi8(4)), _mm_setzero_si128())))
+
+#define SPACE_MASK(p) SPACE_BITS(_mm_loadu_si128((const __m128i *) (p)))
+
+/*
+ * 'v' with its ASCII capitals lower cased.  Bytes above 127 compare as
+ * negative, so they are never taken for capitals.
+ */
+#define LOWER_CASE(v) \
+    _mm_or_si128((v), _mm_and_si128(_mm_set1_epi8(0x20), \
+        _mm_and_si128(_mm_cmpgt_epi8((v), _mm_set1_epi8('A' - 1)), \
+                      _mm_cmplt_epi8((v), _mm_set1_epi8('Z' + 1)))))
+
+#endif
+
+
+/* Return the first byte at or after 'p' that is not whitespace. */
+const char *skip_space(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    int mask;
+
+    while (end - p >= 16) {
+        mask = ~SPACE_MASK(p) & 0xffff;
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && IS_SPACE(*p)) {
+        p++;
+    }
+    return p;
+}
+
+
+/* Return the first whitespace byte at or after 'p', or 'end'. */
+const char *find_space(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    int mask;
+
+    while (end - p >= 16) {
+        mask = SPACE_MASK(p);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && !IS_SPACE(*p)) {
+        p++;
+    }
+    return p;
+}
+
+
+/*
+ * Read everything from 'fd' into a malloc'd buffer.  The buffer is
+ * doubled as needed; memcheck has no realloc, so it is copied by hand.
+ */
+int read_all(tokenizer *t, int fd)
+{
+    char *buf, *bigger;
+    size_t size, capacity;
+    ssize_t n;
+
+    capacity = READ_SIZE;
+    size = 0;
+    buf = (char *) malloc(capacity);
+    if (buf == NULL) {
+        return -1;
+    }
+
+    while (1) {
+        if (capacity - size < READ_SIZE) {
+            bigger = (char *) malloc(capacity * 2);
+            if (bigger == NULL) {
+                free(buf);
+                return -1;
+            }
+            memcpy(bigger, buf, size);
+            free(buf);
+            buf = bigger;
+            capacity *= 2;
+        }
+        n = read(fd, buf + size, READ_SIZE);
+        if (n < 0) {
+            free(buf);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        size += (size_t) n;
+    }
+
+    t->data = buf;
+    t->size = size;
+    t->mapped = 0;
+    return 0;
+}
+
+
+int tokenizer_open(tokenizer *t, const char *filename)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+        t->data = (const char *) map;
+        t->size = (size_t) st.st_size;
+        t->mapped = 1;
+    }
+    else if (read_all(t, fd) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    /* The mapping stays valid after the descriptor is closed. */
+    close(fd);
+    t->pos = t->data;
+    t->end = t->data + t->size;
+    t->normalize = 0;
+    t->word = NULL;
+    t->word_size = 0;
+    return 0;
+}
+
+
+/*** Normalized words. ***/
+
+/*
+ * Make room for 'size' bytes at t->word, keeping its first 'keep'
+ * bytes.  The buffer at least doubles each time, and memcheck has no
+ * realloc, so it is copied by hand.
+ */
+void reserve_word(tokenizer *t, size_t size, size_t keep)
+{
+    char *bigger;
+    size_t new_size;
+
+    if (size <= t->word_size) {
+        return;
+    }
+    new_size = (t->word_size > 0) ? 2 * t->word_size : 64;
+    while (new_size < size) {
+        new_size *= 2;
+    }
+
+    bigger = (char *) malloc(new_size);
+    if (bigger == NULL) {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+    if (t->word != NULL) {
+        memcpy(bigger, t->word, keep);
+        free(t->word);
+    }
+    t->word = bigger;
+    t->word_size = new_size;
+}
+
+
+/*
+ * Copy the word that starts at 'p' to t->word with its ASCII capitals
+ * lower cased, set 'n' to its length and 'high' to whether it has any
+ * bytes above 127, and return the end of the word.
+ */
+const char *copy_lower(tokenizer *t, const char *p, const char *end,
+                       size_t *n, int *high)
+{
+    size_t used;
+    int bits;
+#ifdef __SSE2__
+    __m128i v;
+    int mask;
+#endif
+
+    used = 0;
+    bits = 0;
+#ifdef __SSE2__
+    while (end - p >= 16) {
+        reserve_word(t, used + 16, used);
+        v = _mm_loadu_si128((const __m128i *) p);
+        _mm_storeu_si128((__m128i *) (t->word + used), LOWER_CASE(v));
+        mask = SPACE_BITS(v);
+        if (mask != 0) {
+            mask = __builtin_ctz(mask);
+            *n = used + mask;
+            bits |= _mm_movemask_epi8(v) & ((1 << mask) - 1);
+            *high = bits != 0;
+            return p + mask;
+        }
+        bits |= _mm_movemask_epi8(v);
+        used += 16;
+        p += 16;
+    }
+#endif
+    while (p < end && !IS_SPACE(*p)) {
+        reserve_word(t, used + 1, used);
+        t->word[used++] = IS_UPPER(*p) ? (char) (*p + ('a' - 'A')) : *p;
+        bits |= *p & 0x80;
+        p++;
+    }
+    *n = used;
+    *high = bits != 0;
+    return p;
+}
+
+
+/*
+ * Lower case a capital of the Latin 1 Supplement (except 0x00D7, the
+ * multiplication sign) or of the basic Cyrillic alphabet.
+ */
+unsigned long fold_code_point(unsigned long c)
+{
+    if ((c >= 0xc0 && c <= 0xde && c != 0xd7) ||
+        (c >= 0x410 && c <= 0x42f)) {
+        return c + 0x20;
+    }
+    if (c >= 0x400 && c <= 0x40f) {
+        return c + 0x50;
+    }
+    return c;
+}
+
+
+/*
+ * Write the bytes from 'p' to 'end' to 'out' as valid UTF8, folding
+ * the case of every character, and return the number of bytes written,
+ * at most 3 per byte read.  Each maximal part of an invalid sequence
+ * becomes one replacement character, as the Unicode standard recommends.
+ */
+size_t fold_utf8(char *out, const unsigned char *p,
+                 const unsigned char *end)
+{
+    unsigned long c;
+    unsigned char lo, hi;
+    size_t used;
+    int len, i;
+
+    used = 0;
+    while (p < end) {
+        c = *p;
+        if (c < 0x80) {
+            out[used++] = IS_UPPER(c) ? (char) (c + ('a' - 'A')) : (char) c;
+            p++;
+            continue;
+        }
+
+        /*
+         * The length, the payload bits of the lead byte, and the range
+         * of the second byte, which rules out overlong forms, UTF16
+         * surrogates and code points past 0x10FFFF.
+         */
+        lo = 0x80;
+        hi = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            len = 2;
+            c &= 0x1f;
+        }
+        else if (c >= 0xe0 && c <= 0xef) {
+            len = 3;
+            lo = (c == 0xe0) ? 0xa0 : 0x80;
+            hi = (c == 0xed) ? 0x9f : 0xbf;
+            c &= 0x0f;
+        }
+        else if (c >= 0xf0 && c <= 0xf4) {
+            len = 4;
+            lo = (c == 0xf0) ? 0x90 : 0x80;
+            hi = (c == 0xf4) ? 0x8f : 0xbf;
+            c &= 0x07;
+        }
+        else {
+            len = 1;
+        }
+
+        for (i = 1; i < len && p + i < end; i++) {
+            if (p[i] < lo || p[i] > hi) {
+                break;
+            }
+            c = (c << 6) | (p[i] & 0x3f);
+            lo = 0x80;
+            hi = 0xbf;
+        }
+        if (len == 1 || i < len) {
+            memcpy(out + used, REPLACEMENT, 3);
+            used += 3;
+            p += i;
+            continue;
+        }
+        p += len;
+
+        /* Folding never changes the length of a character. */
+        c = fold_code_point(c);
+        for (i = len - 1; i > 0; i--) {
+            out[used + i] = (char) (0x80 | (c & 0x3f));
+            c >>= 6;
+        }
+        out[used] = (char) ((len == 2 ? 0xc0 : len == 3 ? 0xe0 : 0xf0) | c);
+        used += len;
+    }
+    return used;
+}
+
+
+/*
+ * The number of bytes of punctuation that the valid UTF8 word 'w' of
+ * 'n' bytes starts or ends with: one ASCII mark, a mark of the General
+ * Punctuation block (0x2000 to 0x206F, which is E2 80 80 to E2 81 AF,
+ * stopping short of the superscripts from E2 81 B0), or one of 0x00A1,
+ * 0x00AB, 0x00BB and 0x00BF (C2 and A1, AB, BB or BF).
+ */
+
+#define IS_GENERAL_PUNCT(b, c) \
+    ((b) == 0x80 || ((b) == 0x81 && (c) < 0xb0))
+
+#define IS_LATIN1_PUNCT(c) \
+    ((c) == 0xa1 || (c) == 0xab || (c) == 0xbb || (c) == 0xbf)
+
+size_t leading_punct(const unsigned char *w, size_t n)
+{
+    if (IS_PUNCT(w[0])) {
+        return 1;
+    }
+    if (n >= 3 && w[0] == 0xe2 && IS_GENERAL_PUNCT(w[1], w[2])) {
+        return 3;
+    }
+    if (n >= 2 && w[0] == 0xc2 && IS_LATIN1_PUNCT(w[1])) {
+        return 2;
+    }
+    return 0;
+}
+
+
+size_t trailing_punct(const unsigned char *w, size_t n)
+{
+    if (IS_PUNCT(w[n - 1])) {
+        return 1;
+    }
+    if (n >= 3 && w[n - 3] == 0xe2 && IS_GENERAL_PUNCT(w[n - 2], w[n - 1])) {
+        return 3;
+    }
+    if (n >= 2 && w[n - 2] == 0xc2 && IS_LATIN1_PUNCT(w[n - 1])) {
+        return 2;
+    }
+    return 0;
+}
+
+
+/* next_word() for a tokenizer that normalizes its words. */
+int next_normalized_word(tokenizer *t, const char **word, size_t *len)
+{
+    const char *start;
+    unsigned char *w;
+    size_t n, k;
+    int high;
+
+    while (1) {
+        start = skip_space(t->pos, t->end);
+        if (start == t->end) {
+            t->pos = start;
+            return 0;
+        }
+        t->pos = copy_lower(t, start, t->end, &n, &high);
+        if (high) {
+            reserve_word(t, 3 * n, 0);
+            n = fold_utf8(t->word, (const unsigned char *) start,
+                          (const unsigned char *) t->pos);
+        }
+
+        w = (unsigned char *) t->word;
+        while (n > 0 && (k = leading_punct(w, n)) > 0) {
+            w += k;
+            n -= k;
+        }
+        while (n > 0 && (k = trailing_punct(w, n)) > 0) {
+            n -= k;
+        }
+        if (n > 0) {
+            *word = (const char *) w;
+            *len = n;
+            return 1;
+        }
+    }
+}
+
+
+void tokenizer_normalize(tokenizer *t)
+{
+    t->normalize = 1;
+}
+
+
+int next_word(tokenizer *t, const char **word, size_t *len)
+{
+    const char *start;
+
+    if (t->normalize) {
+        return next_normalized_word(t, word, len);
+    }
+
+    start = skip_space(t->pos, t->end);
+    if (start == t->end) {
+        t->pos = start;
+        return 0;
+    }
+    t->pos = find_space(start, t->end);
+    *word = start;
+    *len = (size_t) (t->pos - start);
+    return 1;
+}
+
+
+void tokenizer_split(const tokenizer *t, tokenizer *parts, int n)
+{
+    const char *start, *stop;
+    int i;
+
+    start = t->data;
+    for (i = 0; i < n; i++) {
+        if (i == n - 1) {
+            stop = t->end;
+        }
+        else {
+            stop = t->data + t->size / n * (i + 1);
+            if (stop < start) {
+                stop = start;
+            }
+            stop = find_space(stop, t->end);
+        }
+
+        parts[i].data = parts[i].pos = start;
+        parts[i].end = stop;
+        parts[i].size = (size_t) (stop - start);
+        parts[i].mapped = -1;
+        parts[i].normalize = t->normalize;
+        parts[i].word = NULL;
+        parts[i].word_size = 0;
+        start = stop;
+    }
+}
+
+
+void tokenizer_close(tokenizer *t)
+{
+    if (t->mapped == 1) {
+        munmap((void *) t->data, t->size);
+    }
+    else if (t->mapped == 0) {
+        free((void *) t->data);
+    }
+    if (t->word != NULL) {
+        free(t->word);
+    }
+    t->data = t->pos = t->end = NULL;
+    t->size = 0;
+    t->word = NULL;
+    t->word_size = 0;
+}
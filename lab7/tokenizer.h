@@ -0,0 +1,78 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: tokenizer.h
+ *
+ *       Declaration of a zero copy word tokenizer.  The input file is
+ *       mapped into memory and words are returned as (pointer, length)
+ *       slices of the mapping, so no word is ever copied just to be
+ *       looked up.  A tokenizer can also normalize the words for case
+ *       insensitive counting (see tokenizer_normalize), in which case
+ *       each word is copied once, as it is found.
+ *
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+
+/*
+ * A word is a maximal run of bytes that are not whitespace (space,
+ * \t, \n, \v, \f or \r), which is what scanf's %s conversion reads.
+ * Any number of words may appear on a line, and words may have any
+ * length.
+ */
+
+typedef struct
+{
+    const char *data;   /* contents of the input */
+    const char *pos;    /* where the next search for a word starts */
+    const char *end;    /* one past the last byte of the input */
+    size_t size;
+    int mapped;         /* 1 if 'data' is a mapping, 0 if malloc'd, */
+                        /* -1 if it belongs to another tokenizer */
+    int normalize;      /* 1 to return normalized words */
+    char *word;         /* the last normalized word, or NULL */
+    size_t word_size;   /* bytes allocated at 'word' */
+} tokenizer;
+
+/*
+ * Open 'filename' for tokenizing.  Regular files are mapped; anything
+ * else (a pipe, say) is read into memory instead.  Return 0 on
+ * success or -1 if the file cannot be opened or read.
+ */
+int tokenizer_open(tokenizer *t, const char *filename);
+
+/*
+ * From now on return the words of 't' normalized: ASCII letters are
+ * lower cased, as are the Latin 1 and basic Cyrillic capitals, bytes
+ * that are not valid UTF8 are replaced by the replacement character
+ * (0xFFFD), and punctuation is stripped from both ends of each word
+ * (ASCII punctuation, the General Punctuation block, and the
+ * guillemets and inverted marks of Latin 1).  Words that are nothing
+ * but punctuation are skipped.
+ */
+void tokenizer_normalize(tokenizer *t);
+
+/*
+ * Find the next word.  Return 1 and set 'word' and 'len' to the word's
+ * first byte and length, or return 0 at the end of the input.  The
+ * word is not zero terminated and stays valid until tokenizer_close(),
+ * or if the tokenizer normalizes words, until the next call.
+ */
+int next_word(tokenizer *t, const char **word, size_t *len);
+
+/*
+ * Divide the input of 't' into 'n' parts of about the same size that
+ * each end on whitespace or at the end of the input, so that no word
+ * is cut in two, and set up parts[i] to tokenize part i.  The parts
+ * share the input of 't' and normalize words if 't' does.  Each part
+ * must be closed, which leaves the input open until 't' is closed.
+ */
+void tokenizer_split(const tokenizer *t, tokenizer *parts, int n);
+
+/* Release the input, unless it belongs to another tokenizer. */
+void tokenizer_close(tokenizer *t);
+
+#endif  /* TOKENIZER_H */
@@ -0,0 +1,102 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: top_k.c
+ *
+ *       Implementation of the bounded top K heap.
+ *
+ */
+
+#include <string.h>
+#include "top_k.h"
+
+
+int beats(const word_count *a, const word_count *b);
+void sift_down(word_count *items, size_t n, size_t i);
+
+
+/* Return nonzero if 'a' ranks above 'b'. */
+int beats(const word_count *a, const word_count *b)
+{
+    if (a->value != b->value) {
+        return a->value > b->value;
+    }
+    return strcmp(a->key, b->key) < 0;
+}
+
+
+/* Move items[i] down until neither child ranks below it. */
+void sift_down(word_count *items, size_t n, size_t i)
+{
+    word_count tmp;
+    size_t child;
+
+    tmp = items[i];
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && beats(&items[child], &items[child + 1])) {
+            child++;
+        }
+        if (!beats(&tmp, &items[child])) {
+            break;
+        }
+        items[i] = items[child];
+        i = child;
+    }
+    items[i] = tmp;
+}
+
+
+void top_k_init(top_k *heap, word_count *items, size_t k)
+{
+    heap->items = items;
+    heap->n = 0;
+    heap->k = k;
+}
+
+
+void top_k_offer(top_k *heap, const char *key, int value)
+{
+    word_count w;
+    size_t i, parent;
+
+    w.key = key;
+    w.value = value;
+
+    if (heap->n < heap->k) {
+        /* Not full: add at the bottom and move up past better words. */
+        i = heap->n++;
+        while (i > 0) {
+            parent = (i - 1) / 2;
+            if (!beats(&heap->items[parent], &w)) {
+                break;
+            }
+            heap->items[i] = heap->items[parent];
+            i = parent;
+        }
+        heap->items[i] = w;
+    }
+    else if (heap->k > 0 && beats(&w, &heap->items[0])) {
+        /* Full: the new word replaces the smallest one. */
+        heap->items[0] = w;
+        sift_down(heap->items, heap->n, 0);
+    }
+}
+
+
+size_t top_k_finish(top_k *heap)
+{
+    word_count tmp;
+    size_t n;
+
+    /*
+     * Heap sort: move the smallest word to the end and shrink the heap,
+     * which leaves the array ordered from the largest count down.
+     */
+    for (n = heap->n; n > 1; n--) {
+        tmp = heap->items[0];
+        heap->items[0] = heap->items[n - 1];
+        heap->items[n - 1] = tmp;
+        sift_down(heap->items, n - 1, 0);
+    }
+    return heap->n;
+}
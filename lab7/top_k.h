@@ -0,0 +1,55 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: top_k.h
+ *
+ *       Declaration of a bounded min heap that keeps the K words with
+ *       the largest counts out of any number of words offered to it.
+ *       Offering N words costs O(N log K) time and O(K) memory, so the
+ *       most common words of a table can be found without sorting or
+ *       printing the whole table.
+ *
+ */
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <stddef.h>
+
+/* A word and its count.  The heap does not copy the word. */
+typedef struct
+{
+    const char *key;
+    int value;
+} word_count;
+
+typedef struct
+{
+    word_count *items;      /* heap order; items[0] is the smallest */
+    size_t n;               /* items in use */
+    size_t k;               /* room in 'items' */
+} top_k;
+
+/*
+ * Initialize an empty heap that keeps at most 'k' words, using the
+ * caller's array 'items' of 'k' entries for storage.
+ */
+void top_k_init(top_k *heap, word_count *items, size_t k);
+
+/*
+ * Offer a word to the heap.  It is kept if the heap is not full yet or
+ * if it beats the smallest word kept so far.  Between equal counts the
+ * word that sorts first wins, so the result does not depend on the
+ * order in which words are offered.  'key' must stay valid until the
+ * heap is finished with.
+ */
+void top_k_offer(top_k *heap, const char *key, int value);
+
+/*
+ * Sort the words kept by the heap from the largest count down, in
+ * place in the 'items' array, and return how many there are.  The
+ * heap must not be offered any more words afterwards.
+ */
+size_t top_k_finish(top_k *heap);
+
+#endif  /* TOP_K_H */
@@ -0,0 +1,25 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: typed_tables.c
+ *
+ *       Definitions of the shared generic hash table instances.
+ *
+ */
+
+#include <string.h>
+#include "typed_tables.h"
+#include "hash_func.h"
+#include "memcheck.h"
+
+#define WORD_HASH(k) hash_string((k), strlen(k))
+#define WORD_EQUAL(a, b) (strcmp((a), (b)) == 0)
+#define WORD_COPY(t, k) arena_strdup(&(t)->keys, (k), strlen(k))
+
+#define ID_EQUAL(a, b) ((a) == (b))
+
+GENERIC_TABLE_DEFINE(word_counts, const char *, count64, WORD_HASH,
+                     WORD_EQUAL, WORD_COPY)
+
+GENERIC_TABLE_DEFINE(id_counts, unsigned long, count64, hash_ulong,
+                     ID_EQUAL, GT_NO_COPY)
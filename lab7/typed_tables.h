@@ -0,0 +1,33 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: typed_tables.h
+ *
+ *       Instances of the generic hash table (generic_table.h) that are
+ *       shared between programs.  Counts are 64 bits wide, so they do
+ *       not overflow on large inputs the way int counts can.
+ *
+ */
+
+#ifndef TYPED_TABLES_H
+#define TYPED_TABLES_H
+
+#include <limits.h>
+#include "generic_table.h"
+
+#if ULONG_MAX > 0xffffffffUL
+typedef unsigned long count64;
+#else
+__extension__ typedef unsigned long long count64;
+#endif
+
+/*
+ * Zero terminated string keys with 64 bit counts.  The table keeps its
+ * own copies of the keys.
+ */
+GENERIC_TABLE_DECLARE(word_counts, const char *, count64)
+
+/* Integer keys with 64 bit counts. */
+GENERIC_TABLE_DECLARE(id_counts, unsigned long, count64)
+
+#endif  /* TYPED_TABLES_H */
@@ -0,0 +1,296 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_output.c
+ *
+ *       Implementation of the word count sorting and printing functions.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include "word_output.h"
+#include "memcheck.h"
+
+/* Key sorts of fewer words than this use insertion sort. */
+#define SMALL_SORT 32
+
+/* Size of the output buffer. */
+#define OUTPUT_BUFFER (1024 * 1024)
+
+/* Room for a space, the longest int and a newline. */
+#define VALUE_ROOM 16
+
+/* Byte 'd' of a word's key; 0 past its end. */
+#define KEY_BYTE(w, d) ((unsigned char) (w).key[d])
+
+/*
+ * Byte 'shift' / 8 of a count, mapped so that ascending byte order is
+ * descending count order, negative counts included.
+ */
+#define SIGN_BIT (~(UINT_MAX >> 1))
+#define COUNT_BYTE(v, shift) \
+    (255 - ((((unsigned int) (v) ^ SIGN_BIT) >> (shift)) & 0xff))
+
+
+void insertion_sort_keys(word_count *words, size_t n, size_t depth);
+void radix_sort_keys(word_count *words, word_count *tmp, size_t n,
+                     size_t depth);
+void write_all(int fd, const char *buf, size_t n);
+
+
+/*** Utilities. ***/
+
+/* Write all 'n' bytes at 'buf', or exit. */
+void write_all(int fd, const char *buf, size_t n)
+{
+    ssize_t done;
+
+    while (n > 0) {
+        done = write(fd, buf, n);
+        if (done < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: cannot write the output! "
+                    "Terminating program.\n");
+            exit(1);
+        }
+        buf += done;
+        n -= (size_t) done;
+    }
+}
+
+
+/*** Sorting. ***/
+
+word_count *gather_hash_tables(hash_table **tables, int ntables,
+                               unsigned long *n)
+{
+    word_count *words;
+    unsigned long total;
+    int t;
+
+    total = 0;
+    for (t = 0; t < ntables; t++) {
+        total += hash_table_size(tables[t]);
+    }
+    /* One more than needed, as there may be no words at all. */
+    words = (word_count *) malloc((total + 1) * sizeof(word_count));
+    if (words == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    *n = 0;
+    for (t = 0; t < ntables; t++) {
+        *n += collect_hash_table(tables[t], words + *n);
+    }
+    return words;
+}
+
+
+/* Sort words by key, knowing that the first 'depth' bytes all agree. */
+void insertion_sort_keys(word_count *words, size_t n, size_t depth)
+{
+    word_count w;
+    size_t i, j;
+
+    for (i = 1; i < n; i++) {
+        w = words[i];
+        for (j = i; j > 0 && strcmp(words[j - 1].key + depth,
+                                    w.key + depth) > 0; j--) {
+            words[j] = words[j - 1];
+        }
+        words[j] = w;
+    }
+}
+
+
+/*
+ * Sort words by key, knowing that the first 'depth' bytes all agree:
+ * distribute them into 256 buckets by byte 'depth', through 'tmp',
+ * then sort each bucket on the next byte.  Bucket 0 holds the keys
+ * that end at 'depth', which are equal.  A byte that all the keys
+ * share is skipped without moving them.
+ */
+void radix_sort_keys(word_count *words, word_count *tmp, size_t n,
+                     size_t depth)
+{
+    size_t count[256], pos[256];
+    size_t i, b;
+
+    while (n >= SMALL_SORT) {
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++) {
+            count[KEY_BYTE(words[i], depth)]++;
+        }
+
+        b = KEY_BYTE(words[0], depth);
+        if (count[b] == n) {
+            if (b == 0) {
+                return;
+            }
+            depth++;
+            continue;
+        }
+
+        pos[0] = 0;
+        for (b = 1; b < 256; b++) {
+            pos[b] = pos[b - 1] + count[b - 1];
+        }
+        for (i = 0; i < n; i++) {
+            tmp[pos[KEY_BYTE(words[i], depth)]++] = words[i];
+        }
+        memcpy(words, tmp, n * sizeof(word_count));
+
+        for (i = count[0], b = 1; b < 256; i += count[b++]) {
+            if (count[b] > 1) {
+                radix_sort_keys(words + i, tmp, count[b], depth + 1);
+            }
+        }
+        return;
+    }
+
+    insertion_sort_keys(words, n, depth);
+}
+
+
+void sort_by_key(word_count *words, size_t n)
+{
+    word_count *tmp;
+
+    if (n < 2) {
+        return;
+    }
+    tmp = (word_count *) malloc(n * sizeof(word_count));
+    if (tmp == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    radix_sort_keys(words, tmp, n, 0);
+    free(tmp);
+}
+
+
+/*
+ * One stable counting pass per byte of the count, lowest byte first,
+ * moving the words back and forth between 'words' and a second array.
+ * A pass in which every count has the same byte is skipped.
+ */
+void sort_by_count(word_count *words, size_t n)
+{
+    word_count *tmp, *from, *to, *swap;
+    size_t count[256];
+    size_t i, b, pos, c;
+    unsigned int shift;
+
+    if (n < 2) {
+        return;
+    }
+    tmp = (word_count *) malloc(n * sizeof(word_count));
+    if (tmp == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    from = words;
+    to = tmp;
+
+    for (shift = 0; shift < sizeof(int) * CHAR_BIT; shift += 8) {
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++) {
+            count[COUNT_BYTE(from[i].value, shift)]++;
+        }
+        if (count[COUNT_BYTE(from[0].value, shift)] == n) {
+            continue;
+        }
+
+        pos = 0;
+        for (b = 0; b < 256; b++) {
+            c = count[b];
+            count[b] = pos;
+            pos += c;
+        }
+        for (i = 0; i < n; i++) {
+            to[count[COUNT_BYTE(from[i].value, shift)]++] = from[i];
+        }
+
+        swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != words) {
+        memcpy(words, from, n * sizeof(word_count));
+    }
+    free(tmp);
+}
+
+
+/*** Output. ***/
+
+void write_word_counts(int fd, word_count *words, size_t n)
+{
+    char *buf;
+    char digits[VALUE_ROOM];
+    size_t used, len, i;
+    unsigned long v;
+    int nd;
+
+    /* Anything already printed with stdio goes first. */
+    fflush(stdout);
+
+    buf = (char *) malloc(OUTPUT_BUFFER);
+    if (buf == NULL) {
+        fprintf(stderr, "Error: memory allocation failed! "
+                "Terminating program.\n");
+        exit(1);
+    }
+    used = 0;
+
+    for (i = 0; i < n; i++) {
+        len = strlen(words[i].key);
+        if (used + len + VALUE_ROOM > OUTPUT_BUFFER) {
+            write_all(fd, buf, used);
+            used = 0;
+        }
+        if (len + VALUE_ROOM > OUTPUT_BUFFER) {
+            /* A huge word: write it straight from the table. */
+            write_all(fd, words[i].key, len);
+        }
+        else {
+            memcpy(buf + used, words[i].key, len);
+            used += len;
+        }
+
+        /* Format the count backwards into 'digits'. */
+        v = words[i].value < 0 ? 0UL - (unsigned long) words[i].value
+                               : (unsigned long) words[i].value;
+        nd = 0;
+        do {
+            digits[nd++] = (char) ('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+
+        buf[used++] = ' ';
+        if (words[i].value < 0) {
+            buf[used++] = '-';
+        }
+        while (nd > 0) {
+            buf[used++] = digits[--nd];
+        }
+        buf[used++] = '\n';
+    }
+
+    write_all(fd, buf, used);
+    free(buf);
+}
@@ -0,0 +1,46 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_output.h
+ *
+ *       Declaration of functions that sort gathered word counts (see
+ *       collect_hash_table() in hash_table.h) and print them, so that
+ *       the output of the word counter needs no external sort.
+ *
+ */
+
+#ifndef WORD_OUTPUT_H
+#define WORD_OUTPUT_H
+
+#include <stddef.h>
+#include "top_k.h"
+#include "hash_table.h"
+
+/*
+ * Gather the words of 'ntables' tables into one new array, which the
+ * caller frees, and set 'n' to their number.
+ */
+word_count *gather_hash_tables(hash_table **tables, int ntables,
+                               unsigned long *n);
+
+/*
+ * Sort words by key, in the byte order of strcmp() (the order of sort
+ * with LC_ALL=C), with a most significant byte first radix sort.
+ */
+void sort_by_key(word_count *words, size_t n);
+
+/*
+ * Sort words by count, largest first, with a stable least significant
+ * byte first radix sort.  Words with equal counts keep their order, so
+ * sorting by key first breaks ties by key.
+ */
+void sort_by_count(word_count *words, size_t n);
+
+/*
+ * Print words as key/value pairs, one per line, to the file descriptor
+ * 'fd'.  The lines are formatted into a large buffer that is passed to
+ * write() whenever it fills, instead of one stdio call per line.
+ */
+void write_word_counts(int fd, word_count *words, size_t n);
+
+#endif  /* WORD_OUTPUT_H */
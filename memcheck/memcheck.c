@@ -0,0 +1,1419 @@
+/*
+ * FILE: memcheck.c
+ *
+ *       Simple-minded memory leak checker for C programs.
+ *
+ *       Each checked allocation is one block from the system allocator:
+ *       the node that describes it, as a header, then the memory handed
+ *       out.  The node keeps a pointer to the name of the file, which is
+ *       a string literal (__FILE__), rather than a copy.
+ *
+ *       Live allocations are kept in a linked list, newest first, and
+ *       are indexed by address in an open addressing hash table, so
+ *       that finding and removing the node of a freed pointer takes
+ *       constant time however many allocations are live.  Each node is
+ *       numbered as it is made, and the leak report lists the nodes
+ *       left newest first.
+ *
+ *       With MEMCHECK_PROFILE set in the environment, allocations are
+ *       also counted by the file and line they come from, and
+ *       print_memory_leaks() first prints a table of these sites, most
+ *       bytes first: how many allocations each made, of how many bytes
+ *       in all, the most bytes live at once, and how long its blocks
+ *       lived.  A lifetime is measured in checked allocations made while
+ *       the block was live, so that it does not depend on the speed of
+ *       the machine.
+ *
+ *       Two more environment variables catch memory errors:
+ *
+ *       MEMCHECK_CANARIES puts a redzone of REDZONE bytes of a known
+ *       value on each side of every block, and checks them when the
+ *       block is freed, and for leaks at exit, so that a write just past
+ *       either end is reported with the site of the block.
+ *
+ *       MEMCHECK_GUARD=N puts one in N blocks of at least GUARD_MIN_SIZE
+ *       bytes on pages of its own, with the block flush against an
+ *       inaccessible guard page, like GWP-ASan.  When such a block is
+ *       freed its pages are made inaccessible too, and kept that way
+ *       until GUARD_SLOTS more are guarded.  An overrun or a use after
+ *       free of a guarded block then faults at once, and is reported
+ *       with the site of the block before the program dies.  Since
+ *       only sampled blocks pay for the pages, N sets the cost.
+ *
+ *       Compile with -DMEMCHECK_THREADS (and link with -pthread) so
+ *       that multithreaded programs can use the checked functions.
+ *       The memory pool is then split into POOL_SHARDS shards by
+ *       address, each with its own list, index and mutex, so threads
+ *       rarely wait for each other.  A block freed by another thread
+ *       than the one that allocated it needs nothing special: its shard
+ *       depends only on its address.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#ifdef MEMCHECK_THREADS
+#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MEMCHECK_C
+#include "memcheck.h"
+
+#define DEBUG 0
+
+/*
+ * Definition of data structure to keep memory allocation information.
+ */
+
+typedef
+struct _mem_node
+{
+    void   *addr;       /* Address of allocated memory.                   */
+    size_t  nbytes;     /* Number of bytes allocated.                     */
+    char   *filename;   /* Name of file where allocation occurred.        */
+    int     lineno;     /* Line number of file where allocation occurred. */
+    int     flags;      /* MEM_CANARIES or MEM_GUARDED, or 0.             */
+    unsigned long serial;       /* Order in which nodes were made. */
+    struct _alloc_site *site;   /* Where it was made, when profiling. */
+    struct _mem_node *next;     /* Next node in linked list. */
+    struct _mem_node *prev;     /* Previous node in linked list. */
+}
+mem_node;
+
+
+/*
+ * The totals of one allocation site, for the profile.  Lifetimes are
+ * binned by powers of LIFETIME_BASE: bin i counts the blocks freed
+ * after fewer than LIFETIME_BASE^(i + 1) other allocations, and the
+ * last bin any longer.
+ */
+
+#define LIFETIME_BINS 6
+#define LIFETIME_BASE 16
+
+typedef
+struct _alloc_site
+{
+    char          *filename;
+    int            lineno;
+    unsigned long  count;       /* Allocations made.            */
+    unsigned long  freed;       /* Allocations freed.           */
+    unsigned long  bytes;       /* Bytes allocated in all.      */
+    unsigned long  live_bytes;  /* Bytes allocated, not freed.  */
+    unsigned long  peak_bytes;  /* Most live bytes at once.     */
+    unsigned long  lifetimes[LIFETIME_BINS];
+}
+alloc_site;
+
+
+/*
+ * The size of the header in front of each block, rounded up so that
+ * the memory after it is aligned for any type, as malloc()'s is.
+ */
+
+#define MEM_ALIGN   16
+#define HEADER_SIZE \
+    ((sizeof(mem_node) + MEM_ALIGN - 1) / MEM_ALIGN * MEM_ALIGN)
+
+
+/*
+ * The kinds of block.  A block with canaries has REDZONE bytes of
+ * CANARY_BYTE between the header and the memory, and as many after the
+ * memory.  A guarded block is mapped on its own pages (see guard_slot).
+ */
+
+#define MEM_CANARIES 1
+#define MEM_GUARDED  2
+
+#define REDZONE     MEM_ALIGN
+#define CANARY_BYTE 0xcb
+
+
+/*
+ * A sampled block on pages of its own: the header and the memory, then
+ * a guard page.  The block is copied here, as the header becomes
+ * inaccessible when the block is freed.  Slots are reused empty ones
+ * first, then the freed ones in turn.
+ */
+
+#define GUARD_SLOTS    256
+#define GUARD_MIN_SIZE 256
+
+#define GUARD_EMPTY 0
+#define GUARD_LIVE  1
+#define GUARD_FREED 2
+
+typedef
+struct _guard_slot
+{
+    char   *base;       /* Start of the mapping.                */
+    size_t  length;     /* Bytes mapped, the guard page last.   */
+    void   *addr;
+    size_t  nbytes;
+    char   *filename;
+    int     lineno;
+    int     state;      /* GUARD_EMPTY, GUARD_LIVE or GUARD_FREED. */
+}
+guard_slot;
+
+
+/*
+ * A shard of the memory pool: a linked list of nodes, newest first,
+ * and its index, a linear probing hash table of the same nodes keyed by
+ * address, with empty slots NULL.  The size of the index is a power of
+ * two and it is kept at most half full.
+ */
+
+typedef
+struct _pool_shard
+{
+    mem_node  *list;
+    mem_node **index;
+    size_t     index_size;
+    size_t     index_count;
+#ifdef MEMCHECK_THREADS
+    pthread_mutex_t lock;
+#endif
+}
+pool_shard;
+
+
+/*
+ * Function prototypes.
+ */
+
+void        allocate_mem_node(mem_node *n, size_t nbytes,
+                              char *filename, int lineno);
+mem_node   *new_block(size_t nbytes, int zero, char *filename, int lineno);
+mem_node   *new_guarded_block(size_t nbytes, char *filename, int lineno);
+void        release_block(mem_node *n);
+int         canaries_intact(mem_node *n);
+guard_slot *take_guard_slot(void);
+void        guard_fault(int sig, siginfo_t *info, void *context);
+void        fault_write(const char *str);
+void        fault_number(unsigned long k, unsigned base);
+void        free_mem_node(mem_node *n);
+void        free_mem_node_and_adjust_pool(pool_shard *s, mem_node *n);
+void        free_shard_nodes(pool_shard *s);
+void        free_all_mem_nodes(void);
+mem_node   *find_node(pool_shard *s, void *addr);
+size_t      hash_address(void *addr);
+pool_shard *shard_of(void *addr);
+size_t      index_slot(pool_shard *s, void *addr);
+void        grow_index(pool_shard *s);
+void        remove_from_index(pool_shard *s, size_t i);
+int         compare_serials(const void *a, const void *b);
+void        init_pool(void);
+alloc_site *find_site(char *filename, int lineno);
+void        profile_alloc(mem_node *n);
+void        profile_free(mem_node *n);
+int         compare_sites(const void *a, const void *b);
+void        print_memory_profile(void);
+void       *checked_malloc_fn(size_t size, char *filename, int lineno);
+void       *checked_calloc_fn(size_t nmemb, size_t size,
+                              char *filename, int lineno);
+void        checked_free_fn(void *ptr, char *filename, int lineno);
+void        print_memory_leaks(void);
+void        dump_pool(void);
+
+
+/*
+ * The memory pool, in shards, as a global variable.  A shard may only
+ * be used with its lock held, and shards are locked in order when more
+ * than one is needed.
+ */
+
+#ifdef MEMCHECK_THREADS
+#define POOL_SHARDS 64
+#else
+#define POOL_SHARDS 1
+#endif
+
+#define MIN_INDEX_SIZE 64
+
+pool_shard pool[POOL_SHARDS];
+
+unsigned long next_serial = 0;
+
+/*
+ * The sites of the profile, in a linear probing hash table keyed by
+ * filename and line, with empty slots NULL.  'profiling' is set from
+ * the environment before the first use of the pool.
+ */
+
+#define MIN_SITES_SIZE 64
+
+int          profiling = 0;
+alloc_site **sites = NULL;
+size_t       sites_size = 0;
+size_t       sites_count = 0;
+
+
+/*
+ * The checks on blocks, also set from the environment: whether blocks
+ * get canaries, and one in how many large blocks is guarded (0 for
+ * none).  Guarded blocks are mapped from guard_fd, a file descriptor of
+ * /dev/zero.
+ */
+
+int           canaries = 0;
+unsigned long guard_rate = 0;
+unsigned long guard_count = 0;
+size_t        page_size = 0;
+int           guard_fd = -1;
+guard_slot    guard_slots[GUARD_SLOTS];
+size_t        guard_cursor = 0;
+
+#ifdef MEMCHECK_THREADS
+pthread_once_t  pool_once = PTHREAD_ONCE_INIT;
+pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t guard_lock = PTHREAD_MUTEX_INITIALIZER;
+#define INIT_POOL()       pthread_once(&pool_once, init_pool)
+#define LOCK_SHARD(s)     (INIT_POOL(), pthread_mutex_lock(&(s)->lock))
+#define UNLOCK_SHARD(s)   pthread_mutex_unlock(&(s)->lock)
+#define LOCK_PROFILE()    pthread_mutex_lock(&profile_lock)
+#define UNLOCK_PROFILE()  pthread_mutex_unlock(&profile_lock)
+#define NEXT_SERIAL()     __atomic_fetch_add(&next_serial, 1, __ATOMIC_RELAXED)
+#define CURRENT_SERIAL()  __atomic_load_n(&next_serial, __ATOMIC_RELAXED)
+#define LOCK_GUARD()      pthread_mutex_lock(&guard_lock)
+#define UNLOCK_GUARD()    pthread_mutex_unlock(&guard_lock)
+#define NEXT_GUARD()      __atomic_fetch_add(&guard_count, 1, __ATOMIC_RELAXED)
+#else
+int pool_ready = 0;
+#define INIT_POOL()       (pool_ready ? 0 : (init_pool(), pool_ready = 1))
+#define LOCK_SHARD(s)     INIT_POOL()
+#define UNLOCK_SHARD(s)
+#define LOCK_PROFILE()
+#define UNLOCK_PROFILE()
+#define NEXT_SERIAL()     (next_serial++)
+#define CURRENT_SERIAL()  (next_serial)
+#define LOCK_GUARD()
+#define UNLOCK_GUARD()
+#define NEXT_GUARD()      (guard_count++)
+#endif
+
+
+/*
+ * Set up the pool, once, before its first use: read the switches from
+ * the environment, initialize the locks of the shards, and catch the
+ * faults of guarded blocks if there are to be any.
+ */
+
+void
+init_pool(void)
+{
+    struct sigaction action;
+    char *rate;
+#ifdef MEMCHECK_THREADS
+    int i;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        pthread_mutex_init(&pool[i].lock, NULL);
+    }
+#endif
+
+    profiling = getenv("MEMCHECK_PROFILE") != NULL;
+    canaries  = getenv("MEMCHECK_CANARIES") != NULL;
+
+    rate = getenv("MEMCHECK_GUARD");
+
+    if (rate != NULL && strtoul(rate, NULL, 10) > 0)
+    {
+        guard_fd  = open("/dev/zero", O_RDWR);
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+        if (guard_fd >= 0)
+        {
+            guard_rate = strtoul(rate, NULL, 10);
+            memset(&action, 0, sizeof(action));
+            action.sa_sigaction = guard_fault;
+            action.sa_flags = SA_SIGINFO;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGSEGV, &action, NULL);
+        }
+    }
+}
+
+
+/**********************************************************************
+ *
+ * Low-level functions for managing the memory pool linked list.
+ *
+ **********************************************************************/
+
+/*
+ * Hash an address.  Allocations are aligned, so the low bits carry
+ * nothing, and nearby addresses must still spread over the index.
+ */
+
+size_t
+hash_address(void *addr)
+{
+    unsigned long a;
+
+    a  = (unsigned long)addr >> 4;
+    a *= 0x9e3779b1UL;
+    return (size_t)(a ^ (a >> 16));
+}
+
+
+/*
+ * Return the shard that keeps the node of 'addr'.  The index of a shard
+ * uses the low bits of the hash, so the shard is picked by higher ones.
+ */
+
+pool_shard *
+shard_of(void *addr)
+{
+    return &pool[(hash_address(addr) >> 24) % POOL_SHARDS];
+}
+
+
+/*
+ * Return the slot of the index of shard 's' that holds the node of
+ * 'addr', or the empty slot where it would go.  The index must not be
+ * empty.
+ */
+
+size_t
+index_slot(pool_shard *s, void *addr)
+{
+    size_t i, mask;
+
+    mask = s->index_size - 1;
+
+    for (i = hash_address(addr) & mask; s->index[i] != NULL;
+         i = (i + 1) & mask)
+    {
+        if (s->index[i]->addr == addr)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/*
+ * Double the size of the index of shard 's' and put every node of the
+ * shard back into it.
+ */
+
+void
+grow_index(pool_shard *s)
+{
+    mem_node *n;
+
+    free(s->index);
+    s->index_size = (s->index_size == 0) ? MIN_INDEX_SIZE
+                                         : 2 * s->index_size;
+    s->index = (mem_node **)calloc(s->index_size, sizeof(mem_node *));
+
+    if (s->index == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    for (n = s->list; n != NULL; n = n->next)
+    {
+        s->index[index_slot(s, n->addr)] = n;
+    }
+}
+
+
+/*
+ * Empty slot 'i' of the index of shard 's'.  Later nodes of the same
+ * run are moved back into the gap if their home slot allows it, so
+ * that no lookup stops short at the gap (backward shift deletion).
+ */
+
+void
+remove_from_index(pool_shard *s, size_t i)
+{
+    size_t j, home, mask;
+
+    mask = s->index_size - 1;
+    s->index[i] = NULL;
+    s->index_count--;
+
+    for (j = (i + 1) & mask; s->index[j] != NULL; j = (j + 1) & mask)
+    {
+        home = hash_address(s->index[j]->addr) & mask;
+
+        /* Move the node unless its home lies cyclically in (i, j]. */
+        if ((j > i && (home <= i || home > j)) ||
+            (j < i && (home <= i && home > j)))
+        {
+            s->index[i] = s->index[j];
+            s->index[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+
+/*
+ * Set the values of the memory node 'n' at the head of a new block (see
+ * new_block()) and link it into the list and the index of its shard of
+ * the memory pool.
+ */
+
+void
+allocate_mem_node(mem_node *n, size_t nbytes, char *filename, int lineno)
+{
+    pool_shard *s;
+    void *addr;
+
+    addr = n->addr;
+
+#if DEBUG == 1
+    fprintf(stderr, "Allocating %d bytes of memory at %p\n",
+            nbytes, addr);
+#endif
+
+    n->nbytes   = nbytes;
+    n->filename = filename;
+    n->lineno   = lineno;
+    n->serial   = NEXT_SERIAL();
+    n->site     = NULL;
+
+    if (profiling)
+    {
+        LOCK_PROFILE();
+        n->site = find_site(filename, lineno);
+        profile_alloc(n);
+        UNLOCK_PROFILE();
+    }
+
+    /* Add it to the front of its shard. */
+    s = shard_of(addr);
+    LOCK_SHARD(s);
+    n->next = s->list;
+    n->prev = NULL;
+
+    if (s->list != NULL)
+    {
+        s->list->prev = n;
+    }
+
+    s->list = n;
+
+    /* Index it, growing the index first if it would be over half full. */
+    if (2 * (s->index_count + 1) > s->index_size)
+    {
+        grow_index(s);
+    }
+    else
+    {
+        s->index[index_slot(s, addr)] = n;
+    }
+
+    s->index_count++;
+    UNLOCK_SHARD(s);
+}
+
+
+/*
+ * Free a memory node from the pool.
+ */
+
+void
+free_mem_node(mem_node *n)
+{
+    if (n != NULL)
+    {
+        if (n->addr == NULL)
+        {
+            fprintf(stderr, "ERROR: invalid node at: %p\n", n->addr);
+            return;
+        }
+
+#if DEBUG == 1
+        fprintf(stderr, "Freeing memory at %p\n", n->addr);
+#endif
+
+        release_block(n);
+    }
+}
+
+
+/*
+ * Free a memory node from shard 's' of the pool.  Adjust the 'next'
+ * pointer of the previous node (if any) to skip over this node, and
+ * drop the node from the index.
+ */
+
+void
+free_mem_node_and_adjust_pool(pool_shard *s, mem_node *n)
+{
+    remove_from_index(s, index_slot(s, n->addr));
+
+    if (n->prev == NULL)
+    {
+        /* The node to be removed is the first node. */
+        s->list = n->next;
+    }
+    else
+    {
+        /*
+         * The node is in the interior of the memory pool linked list.
+         * Adjust the 'next' pointer of the previous node.
+         */
+        n->prev->next = n->next;
+    }
+
+    if (n->next != NULL)
+    {
+        n->next->prev = n->prev;
+    }
+
+    if (n->site != NULL)
+    {
+        LOCK_PROFILE();
+        profile_free(n);
+        UNLOCK_PROFILE();
+    }
+
+    free_mem_node(n);
+}
+
+
+/*
+ * Free all the memory nodes of shard 's', which must be locked.
+ */
+
+void
+free_shard_nodes(pool_shard *s)
+{
+    mem_node *n, *next;
+
+    n = s->list;
+
+    while (n != NULL)
+    {
+        next = n->next;
+        free_mem_node(n);
+        n = next;
+    }
+
+    s->list = NULL;
+    free(s->index);
+    s->index       = NULL;
+    s->index_size  = 0;
+    s->index_count = 0;
+}
+
+
+/*
+ * Free all the memory nodes from the pool.
+ */
+
+void
+free_all_mem_nodes(void)
+{
+    int i;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        LOCK_SHARD(&pool[i]);
+        free_shard_nodes(&pool[i]);
+        UNLOCK_SHARD(&pool[i]);
+    }
+}
+
+
+/*
+ * Return the node of shard 's' that corresponds to the address 'addr',
+ * or NULL if the address isn't found.
+ */
+
+mem_node *
+find_node(pool_shard *s, void *addr)
+{
+    if (s->index_count == 0)
+    {
+        return NULL;
+    }
+
+    return s->index[index_slot(s, addr)];
+}
+
+
+/*
+ * Order nodes by their serial numbers, newest first, for qsort().
+ */
+
+int
+compare_serials(const void *a, const void *b)
+{
+    unsigned long sa, sb;
+
+    sa = (*(mem_node * const *)a)->serial;
+    sb = (*(mem_node * const *)b)->serial;
+    return (sa < sb) - (sa > sb);
+}
+
+
+/*
+ * A debugging function to print the contents of the memory pool
+ * linked lists, shard by shard.
+ */
+
+void
+dump_pool(void)
+{
+    mem_node *n;
+    int i;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        for (n = pool[i].list; n != NULL; n = n->next)
+        {
+            fprintf(stderr, "NODE --------\n");
+            fprintf(stderr, "location: %p\n", (void *)n);
+            fprintf(stderr, "addr: %p\n", n->addr);
+            fprintf(stderr, "nbytes: %d\n", (int)n->nbytes);
+            fprintf(stderr, "filename: %s\n", n->filename);
+            fprintf(stderr, "line number: %d\n", n->lineno);
+            fprintf(stderr, "serial: %lu\n", n->serial);
+            fprintf(stderr, "next: %p\n", (void *)n->next);
+            fprintf(stderr, "prev: %p\n", (void *)n->prev);
+            fprintf(stderr, "\n");
+        }
+    }
+}
+
+
+/**********************************************************************
+ *
+ * Low-level functions for getting blocks from the system and checking
+ * them.
+ *
+ **********************************************************************/
+
+/*
+ * Get a block for 'nbytes' bytes of memory, zeroed if 'zero' is
+ * nonzero, with room for its node at the head, and set the node's
+ * address and flags.  The block is guarded if it is sampled, and has
+ * canaries if they are on.  Return NULL if there is no memory.
+ */
+
+mem_node *
+new_block(size_t nbytes, int zero, char *filename, int lineno)
+{
+    mem_node *n;
+    size_t redzone;
+
+    INIT_POOL();
+
+    if (guard_rate > 0 && nbytes >= GUARD_MIN_SIZE &&
+        NEXT_GUARD() % guard_rate == 0)
+    {
+        n = new_guarded_block(nbytes, filename, lineno);
+
+        if (n != NULL)
+        {
+            return n;
+        }
+    }
+
+    redzone = canaries ? REDZONE : 0;
+
+    if (nbytes > (size_t)-1 - HEADER_SIZE - 2 * redzone)
+    {
+        return NULL;
+    }
+
+    if (zero)
+    {
+        n = (mem_node *)calloc(1, HEADER_SIZE + nbytes + 2 * redzone);
+    }
+    else
+    {
+        n = (mem_node *)malloc(HEADER_SIZE + nbytes + 2 * redzone);
+    }
+
+    if (n == NULL)
+    {
+        return NULL;
+    }
+
+    n->addr  = (char *)n + HEADER_SIZE + redzone;
+    n->flags = 0;
+
+    if (canaries)
+    {
+        n->flags = MEM_CANARIES;
+        memset((char *)n->addr - REDZONE, CANARY_BYTE, REDZONE);
+        memset((char *)n->addr + nbytes, CANARY_BYTE, REDZONE);
+    }
+
+    return n;
+}
+
+
+/*
+ * Map a guarded block for 'nbytes' bytes of memory, which ends where
+ * its guard page starts, and note it in a guard slot.  The memory
+ * starts aligned, so up to MEM_ALIGN - 1 bytes past its end are not
+ * guarded.  Return NULL if no slot or no mapping is free, so that the
+ * block is made the usual way instead.
+ */
+
+mem_node *
+new_guarded_block(size_t nbytes, char *filename, int lineno)
+{
+    guard_slot *g;
+    mem_node *n;
+    size_t span, length;
+    char *base;
+
+    span = HEADER_SIZE + (nbytes + MEM_ALIGN - 1) / MEM_ALIGN * MEM_ALIGN;
+
+    if (span < nbytes || span > (size_t)-1 - 2 * page_size)
+    {
+        return NULL;
+    }
+
+    length = (span + page_size - 1) / page_size * page_size + page_size;
+
+    LOCK_GUARD();
+    g = take_guard_slot();
+
+    if (g == NULL)
+    {
+        UNLOCK_GUARD();
+        return NULL;
+    }
+
+    base = (char *)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        guard_fd, 0);
+
+    if (base == (char *)MAP_FAILED)
+    {
+        UNLOCK_GUARD();
+        return NULL;
+    }
+
+    mprotect(base + length - page_size, page_size, PROT_NONE);
+
+    n = (mem_node *)(base + length - page_size - span);
+    n->addr  = (char *)n + HEADER_SIZE;
+    n->flags = MEM_GUARDED;
+
+    g->base     = base;
+    g->length   = length;
+    g->addr     = n->addr;
+    g->nbytes   = nbytes;
+    g->filename = filename;
+    g->lineno   = lineno;
+    g->state    = GUARD_LIVE;
+    UNLOCK_GUARD();
+
+    return n;
+}
+
+
+/*
+ * Return a guard slot to use, with any block it held unmapped, or NULL
+ * if every slot holds a live block.  The guard lock must be held.
+ */
+
+guard_slot *
+take_guard_slot(void)
+{
+    guard_slot *g;
+    size_t i;
+
+    for (i = 0; i < GUARD_SLOTS; i++)
+    {
+        if (guard_slots[i].state == GUARD_EMPTY)
+        {
+            return &guard_slots[i];
+        }
+    }
+
+    /* Reuse the freed blocks in turn, so each stays guarded longest. */
+    for (i = 0; i < GUARD_SLOTS; i++)
+    {
+        g = &guard_slots[guard_cursor];
+        guard_cursor = (guard_cursor + 1) % GUARD_SLOTS;
+
+        if (g->state == GUARD_FREED)
+        {
+            munmap(g->base, g->length);
+            g->state = GUARD_EMPTY;
+            return g;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Give a block back to the system.  The pages of a guarded block are
+ * mapped again without access, which drops their contents but keeps
+ * the addresses, so that a use after free faults.
+ */
+
+void
+release_block(mem_node *n)
+{
+    size_t i;
+
+    if (!(n->flags & MEM_GUARDED))
+    {
+        free(n);
+        return;
+    }
+
+    LOCK_GUARD();
+
+    for (i = 0; i < GUARD_SLOTS; i++)
+    {
+        if (guard_slots[i].state == GUARD_LIVE &&
+            guard_slots[i].addr == n->addr)
+        {
+            mmap(guard_slots[i].base, guard_slots[i].length, PROT_NONE,
+                 MAP_PRIVATE | MAP_FIXED, guard_fd, 0);
+            guard_slots[i].state = GUARD_FREED;
+            break;
+        }
+    }
+
+    UNLOCK_GUARD();
+}
+
+
+/*
+ * Return nonzero if the redzones of a block are as they were made, or
+ * if it has none.
+ */
+
+int
+canaries_intact(mem_node *n)
+{
+    unsigned char *front, *back;
+    size_t i;
+
+    if (!(n->flags & MEM_CANARIES))
+    {
+        return 1;
+    }
+
+    front = (unsigned char *)n->addr - REDZONE;
+    back  = (unsigned char *)n->addr + n->nbytes;
+
+    for (i = 0; i < REDZONE; i++)
+    {
+        if (front[i] != CANARY_BYTE || back[i] != CANARY_BYTE)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ * Catch a fault, and if it lies in the pages of a guarded block, say
+ * what went wrong there.  Then let the fault happen again with the
+ * default action, which ends the program.  Only write() is safe to use
+ * here, so numbers are written out by hand.
+ */
+
+void
+guard_fault(int sig, siginfo_t *info, void *context)
+{
+    guard_slot *g;
+    char *p;
+    size_t i;
+
+    p = (char *)info->si_addr;
+
+    for (i = 0; i < GUARD_SLOTS; i++)
+    {
+        g = &guard_slots[i];
+
+        if (g->state != GUARD_EMPTY && p >= g->base &&
+            p < g->base + g->length)
+        {
+            if (g->state == GUARD_FREED)
+            {
+                fault_write("ERROR: use after free at 0x");
+            }
+            else
+            {
+                fault_write("ERROR: invalid access at 0x");
+            }
+
+            fault_number((unsigned long)p, 16);
+            fault_write(" of ");
+            fault_number((unsigned long)g->nbytes, 10);
+            fault_write(" bytes allocated at 0x");
+            fault_number((unsigned long)g->addr, 16);
+            fault_write(" in file: ");
+            fault_write(g->filename);
+            fault_write(", line: ");
+            fault_number((unsigned long)g->lineno, 10);
+            fault_write("\n");
+            break;
+        }
+    }
+
+    (void)context;
+    signal(sig, SIG_DFL);
+}
+
+
+/*
+ * Write a string to stderr, from a signal handler.
+ */
+
+void
+fault_write(const char *str)
+{
+    ssize_t ignored;
+
+    ignored = write(2, str, strlen(str));
+    (void)ignored;
+}
+
+
+/*
+ * Write a number in base 10 or 16 to stderr, from a signal handler.
+ */
+
+void
+fault_number(unsigned long k, unsigned base)
+{
+    char buf[32];
+    int i;
+
+    i = sizeof(buf) - 1;
+    buf[i] = '\0';
+
+    do
+    {
+        buf[--i] = "0123456789abcdef"[k % base];
+        k /= base;
+    }
+    while (k > 0);
+
+    fault_write(buf + i);
+}
+
+
+/**********************************************************************
+ *
+ * Low-level functions for the allocation profile.  The profile must be
+ * locked around each of them.
+ *
+ **********************************************************************/
+
+/*
+ * Return the site of 'filename' and 'lineno', adding it if it is new.
+ * A file's name is the same string literal at every site in the file,
+ * so sites are told apart by its address.
+ */
+
+alloc_site *
+find_site(char *filename, int lineno)
+{
+    alloc_site **old;
+    alloc_site *site;
+    size_t i, j, mask, old_size;
+
+    if (2 * (sites_count + 1) > sites_size)
+    {
+        /* Double the table and put every site back into it. */
+        old      = sites;
+        old_size = sites_size;
+        sites_size = (old_size == 0) ? MIN_SITES_SIZE : 2 * old_size;
+        sites = (alloc_site **)calloc(sites_size, sizeof(alloc_site *));
+
+        if (sites == NULL)
+        {
+            fprintf(stderr,
+                    "ERROR: memory allocation failed!  Aborting...\n");
+            exit(1);
+        }
+
+        for (j = 0; j < old_size; j++)
+        {
+            if (old[j] != NULL)
+            {
+                for (i = (hash_address(old[j]->filename) + old[j]->lineno)
+                         & (sites_size - 1);
+                     sites[i] != NULL; i = (i + 1) & (sites_size - 1))
+                {
+                    /* Keep probing. */
+                }
+
+                sites[i] = old[j];
+            }
+        }
+
+        free(old);
+    }
+
+    mask = sites_size - 1;
+
+    for (i = (hash_address(filename) + lineno) & mask; sites[i] != NULL;
+         i = (i + 1) & mask)
+    {
+        if (sites[i]->filename == filename && sites[i]->lineno == lineno)
+        {
+            return sites[i];
+        }
+    }
+
+    site = (alloc_site *)calloc(1, sizeof(alloc_site));
+
+    if (site == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    site->filename = filename;
+    site->lineno   = lineno;
+    sites[i] = site;
+    sites_count++;
+    return site;
+}
+
+
+/*
+ * Count a new block at its site.
+ */
+
+void
+profile_alloc(mem_node *n)
+{
+    alloc_site *site;
+
+    site = n->site;
+    site->count++;
+    site->bytes      += n->nbytes;
+    site->live_bytes += n->nbytes;
+
+    if (site->live_bytes > site->peak_bytes)
+    {
+        site->peak_bytes = site->live_bytes;
+    }
+}
+
+
+/*
+ * Count a freed block at its site, and bin its lifetime.
+ */
+
+void
+profile_free(mem_node *n)
+{
+    alloc_site *site;
+    unsigned long lifetime;
+    int bin;
+
+    site = n->site;
+    site->freed++;
+    site->live_bytes -= n->nbytes;
+
+    lifetime = CURRENT_SERIAL() - n->serial - 1;
+
+    for (bin = 0; bin < LIFETIME_BINS - 1 && lifetime >= LIFETIME_BASE;
+         bin++)
+    {
+        lifetime /= LIFETIME_BASE;
+    }
+
+    site->lifetimes[bin]++;
+}
+
+
+/*
+ * Order sites by the bytes they allocated, most first, then by the
+ * number of allocations, for qsort().
+ */
+
+int
+compare_sites(const void *a, const void *b)
+{
+    const alloc_site *sa, *sb;
+
+    sa = *(alloc_site * const *)a;
+    sb = *(alloc_site * const *)b;
+
+    if (sa->bytes != sb->bytes)
+    {
+        return (sa->bytes < sb->bytes) - (sa->bytes > sb->bytes);
+    }
+
+    return (sa->count < sb->count) - (sa->count > sb->count);
+}
+
+
+/*
+ * Print the profile, most bytes first, and free its sites.  Blocks
+ * still live are counted as leaked rather than given a lifetime.
+ */
+
+void
+print_memory_profile(void)
+{
+    static const char *bin_names[LIFETIME_BINS] =
+        { "<16", "<256", "<4K", "<64K", "<1M", "more" };
+    size_t i, n;
+    int bin;
+
+    /* Pack the sites at the front of the table, and sort them. */
+    n = 0;
+
+    for (i = 0; i < sites_size; i++)
+    {
+        if (sites[i] != NULL)
+        {
+            sites[n++] = sites[i];
+        }
+    }
+
+    qsort(sites, n, sizeof(alloc_site *), compare_sites);
+
+    fprintf(stderr, "Memory profile: %lu sites; lifetimes in "
+            "allocations made meanwhile.\n", (unsigned long)n);
+    fprintf(stderr, "%10s %12s %12s %8s", "allocs", "bytes", "peak live",
+            "leaked");
+
+    for (bin = 0; bin < LIFETIME_BINS; bin++)
+    {
+        fprintf(stderr, " %8s", bin_names[bin]);
+    }
+
+    fprintf(stderr, "  site\n");
+
+    for (i = 0; i < n; i++)
+    {
+        fprintf(stderr, "%10lu %12lu %12lu %8lu", sites[i]->count,
+                sites[i]->bytes, sites[i]->peak_bytes,
+                sites[i]->count - sites[i]->freed);
+
+        for (bin = 0; bin < LIFETIME_BINS; bin++)
+        {
+            fprintf(stderr, " %8lu", sites[i]->lifetimes[bin]);
+        }
+
+        fprintf(stderr, "  %s:%d\n", sites[i]->filename, sites[i]->lineno);
+        free(sites[i]);
+    }
+
+    free(sites);
+    sites       = NULL;
+    sites_size  = 0;
+    sites_count = 0;
+}
+
+
+/**********************************************************************
+ *
+ * User-level functions.
+ *
+ * NOTE: Normally, the user will not use these functions, but will
+ *       use 'malloc' and 'calloc' wrappers defined in "memcheck.h".
+ *
+ **********************************************************************/
+
+
+/*
+ * Allocate 'size' bytes of memory.  Also add the address, filename, and line
+ * number as a new node in the memory pool linked list.
+ */
+
+void *
+checked_malloc_fn(size_t size, char *filename, int lineno)
+{
+    mem_node *n;
+
+    n = new_block(size, 0, filename, lineno);
+
+    if (n == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    allocate_mem_node(n, size, filename, lineno);
+    return n->addr;
+}
+
+
+/*
+ * This function is the same as 'checked_malloc' except that it has
+ * a different signature (corresponding to 'calloc' in the first two
+ * arguments) and zeroes out all the allocated memory.
+ */
+
+void *
+checked_calloc_fn(size_t nmemb, size_t size, char *filename, int lineno)
+{
+    mem_node *n;
+
+    n = NULL;
+
+    if (size == 0 || nmemb <= (size_t)-1 / size)
+    {
+        n = new_block(nmemb * size, 1, filename, lineno);
+    }
+
+    if (n == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    allocate_mem_node(n, (nmemb * size), filename, lineno);
+    return n->addr;
+}
+
+
+/*
+ * Free a pointer that was previously allocated by 'checked_malloc()'.  If
+ * the memory being freed is not found in the memory pool, or if its
+ * canaries show it was overrun, print an error message and abort.
+ */
+
+void
+checked_free_fn(void *ptr, char *filename, int lineno)
+{
+    pool_shard *s;
+    mem_node *n;
+
+    s = shard_of(ptr);
+    LOCK_SHARD(s);
+    n = find_node(s, ptr);
+
+    if (n == NULL)
+    {
+        UNLOCK_SHARD(s);
+        fprintf(stderr,
+                "ERROR: invalid attempt to free unallocated memory at %p "
+                "in file: %s, line: %d\n", ptr, filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+    else if (!canaries_intact(n))
+    {
+        UNLOCK_SHARD(s);
+        fprintf(stderr,
+                "ERROR: memory overrun of %d bytes allocated at %p in "
+                "file: %s, line: %d, found when freed in file: %s, "
+                "line: %d\n", (int)n->nbytes, n->addr, n->filename,
+                n->lineno, filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+    else
+    {
+        free_mem_node_and_adjust_pool(s, n);
+    }
+
+    UNLOCK_SHARD(s);
+}
+
+
+/*
+ * This function is intended to be called at the end of a program only.
+ * It goes through the memory pool node-by-node and prints out information
+ * on the contents of the node.  Any nodes that exist at the end of the
+ * program represent leaked memory.
+ */
+
+void
+print_memory_leaks(void)
+{
+    mem_node **leaks;
+    mem_node *n;
+    size_t nleaks, i;
+
+    LOCK_PROFILE();
+
+    if (sites != NULL)
+    {
+        print_memory_profile();
+    }
+
+    UNLOCK_PROFILE();
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        LOCK_SHARD(&pool[i]);
+    }
+
+    /* Gather the nodes of every shard, and list them newest first. */
+    nleaks = 0;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        nleaks += pool[i].index_count;
+    }
+
+    leaks = (mem_node **)malloc((nleaks + 1) * sizeof(mem_node *));
+
+    if (leaks == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    nleaks = 0;
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        for (n = pool[i].list; n != NULL; n = n->next)
+        {
+            leaks[nleaks++] = n;
+        }
+    }
+
+    qsort(leaks, nleaks, sizeof(mem_node *), compare_serials);
+
+    for (i = 0; i < nleaks; i++)
+    {
+        n = leaks[i];
+        fprintf(stderr,
+                "Memory leak: %d bytes allocated at %p in "
+                "file: %s, line: %d.\n",
+                (int)n->nbytes, n->addr, n->filename, n->lineno);
+
+        if (!canaries_intact(n))
+        {
+            fprintf(stderr,
+                    "Memory overrun: %d bytes allocated at %p in "
+                    "file: %s, line: %d.\n",
+                    (int)n->nbytes, n->addr, n->filename, n->lineno);
+        }
+    }
+
+    free(leaks);
+
+    for (i = 0; i < POOL_SHARDS; i++)
+    {
+        free_shard_nodes(&pool[i]);
+        UNLOCK_SHARD(&pool[i]);
+    }
+}
@@ -3,6 +3,13 @@
  *
  *       Interface to the memory leak checker.
  *
+ *       The checker is built once, as a static library for each lab to
+ *       link (see the Makefile): libmemcheck.a, and libmemcheck_mt.a for
+ *       multithreaded programs.  Compile a program with
+ *       -DMEMCHECK_DISABLE to turn the checker off altogether: malloc(),
+ *       calloc() and free() are then the standard ones and
+ *       print_memory_leaks() does nothing, so there is no cost at all.
+ *
  */
 
 #ifndef MEMCHECK_H
@@ -20,15 +27,20 @@ void  print_memory_leaks(void);
  * Macros which maintain the interface of the standard malloc/calloc/free
  * functions.  Don't include these if this file is being included into
  * memcheck.c, or it will screw up the definitions of the checked functions.
+ * Without the checker, only print_memory_leaks() needs replacing.
  */
 
-#ifndef MEMCHECK_C
+#if defined(MEMCHECK_DISABLE) && !defined(MEMCHECK_C)
+
+#define print_memory_leaks() ((void)0)
+
+#elif !defined(MEMCHECK_C)
 
 #define malloc(n)    checked_malloc_fn((n), __FILE__, __LINE__)
 #define calloc(n, m) checked_calloc_fn((n), (m), __FILE__, __LINE__)
 #define free(p)      checked_free_fn((p), __FILE__, __LINE__)
 
-#endif  /* MEMCHECK_C */
+#endif  /* MEMCHECK_DISABLE, MEMCHECK_C */
 
 #endif  /* MEMCHECK_H */
 
@@ -0,0 +1,68 @@
+/*
+ * FILE: test_memcheck.c
+ *
+ *       Make one memory error, named on the command line, for run_test
+ *       to check that memcheck reports it:
+ *
+ *       overrun         write one byte past a small block and free it
+ *       guard_overrun   write one byte past a block of GUARDED_SIZE bytes
+ *       use_after_free  write into a block of GUARDED_SIZE bytes after
+ *                       freeing it
+ *       none            use a block correctly
+ *
+ *       Run the first with MEMCHECK_CANARIES and the next two with
+ *       MEMCHECK_GUARD=1.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memcheck.h"
+
+/* Large enough to be guarded, and a multiple of the block alignment. */
+#define GUARDED_SIZE 400
+
+#define SMALL_SIZE 10
+
+
+int
+main(int argc, char **argv)
+{
+    char *p;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s overrun | guard_overrun | "
+                "use_after_free | none\n", argv[0]);
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "overrun"))
+    {
+        p = (char *)malloc(SMALL_SIZE);
+        memset(p, 'x', SMALL_SIZE + 1);
+        free(p);
+    }
+    else if (!strcmp(argv[1], "guard_overrun"))
+    {
+        p = (char *)malloc(GUARDED_SIZE);
+        p[GUARDED_SIZE] = 'x';
+        free(p);
+    }
+    else if (!strcmp(argv[1], "use_after_free"))
+    {
+        p = (char *)malloc(GUARDED_SIZE);
+        free(p);
+        p[0] = 'x';
+    }
+    else
+    {
+        p = (char *)malloc(GUARDED_SIZE);
+        memset(p, 'x', GUARDED_SIZE);
+        free(p);
+    }
+
+    print_memory_leaks();
+    return 0;
+}